@@ -0,0 +1,182 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include "json/reader.h"
+#include "json/parallelreader.h"
+#include "json/writer.h"
+#include "json/elements.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace json;
+
+
+// best of a few runs, in milliseconds. each run gets a fresh ResultT to work on,
+//  which is destroyed after the clock stops
+template <typename ResultT, typename RunT>
+double Time(RunT fRun, int nRuns = 5)
+{
+   double dBest = 0;
+   for (int nRun = 0; nRun < nRuns; ++nRun)
+   {
+      ResultT result;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      fRun(result);
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      if (nRun == 0 || elapsed.count() < dBest)
+         dBest = elapsed.count();
+   }
+   return dBest;
+}
+
+
+// a big array of records, like the nightly batch files ParallelReader is for
+void BenchParallel()
+{
+   std::ostringstream streamRecords;
+   streamRecords << '[';
+   for (int nRecord = 0; nRecord < 250000; ++nRecord)
+   {
+      streamRecords << (nRecord ? ",\n" : "\n")
+                    << "{\"Id\": " << nRecord
+                    << ", \"Name\": \"Record " << nRecord << "\""
+                    << ", \"Price\": " << nRecord * 0.25
+                    << ", \"Tags\": [\"new\", \"batch\"]"
+                    << ", \"Active\": " << (nRecord % 2 ? "true" : "false") << '}';
+   }
+   streamRecords << "\n]";
+   const std::string sRecords = streamRecords.str();
+
+   std::cout << "ParallelReader, " << sRecords.size() / (1024 * 1024) << " MB array of records ("
+             << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+   std::cout << "   threads        ms   speedup" << std::endl;
+
+   double dSequential = 0;
+   for (unsigned int nThreads = 1; nThreads <= 16; nThreads *= 2)
+   {
+      NameTable names(true);
+      ParallelReader parallelReader(nThreads, names);
+      double dTime = Time<Array>([&](Array& arrayRecords) {
+         parallelReader.Read(arrayRecords, sRecords);
+      });
+      if (nThreads == 1)
+         dSequential = dTime;
+
+      std::cout << std::setw(10) << nThreads 
+                << std::setw(10) << std::fixed << std::setprecision(1) << dTime
+                << std::setw(9) << std::setprecision(2) << dSequential / dTime << 'x' << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+
+// objects nested ever deeper. each level's member is parsed straight into place,
+//  so the time per level should stay flat as the depth grows
+void BenchNested()
+{
+   std::cout << "Reader, nested objects" << std::endl;
+   std::cout << "     depth        ms  ns/level" << std::endl;
+
+   for (int nDepth = 1000; nDepth <= 16000; nDepth *= 2)
+   {
+      std::string sNested;
+      for (int nLevel = 0; nLevel < nDepth; ++nLevel)
+         sNested += "{\"Depth\": " + std::to_string(nLevel) + ", \"Child\": ";
+      sNested += "null";
+      sNested.append(nDepth, '}');
+
+      double dTime = Time<Object>([&](Object& objNested) {
+         Reader::Read(objNested, sNested);
+      });
+
+      std::cout << std::setw(10) << nDepth 
+                << std::setw(10) << std::fixed << std::setprecision(2) << dTime
+                << std::setw(10) << std::setprecision(0) << dTime * 1e6 / nDepth << std::endl;
+   }
+   std::cout << std::endl;
+}
+
+
+// writing numbers: shortest round trip formatting (with whole numbers written 
+//  directly) against the old iostream std::setprecision(20) path
+void BenchNumbers()
+{
+   Array arrayNumbers;
+   for (int nNumber = 0; nNumber < 1000000; ++nNumber)
+   {
+      switch (nNumber % 3)
+      {
+         case 0:  arrayNumbers.Insert(Number(nNumber)); break;              // whole
+         case 1:  arrayNumbers.Insert(Number(nNumber / 10.0)); break;       // short decimal
+         default: arrayNumbers.Insert(Number(nNumber * 3.14159265358979)); break;
+      }
+   }
+
+   Writer::Options options;
+   options.m_bCompact = true;
+   std::string sShortest;
+   double dShortest = Time<std::string>([&](std::string& sOut) {
+      Writer::Write(arrayNumbers, sOut, options);
+      sShortest.swap(sOut);
+   });
+
+   std::string sIostream;
+   double dIostream = Time<std::ostringstream>([&](std::ostringstream& ostr) {
+      ostr << std::setprecision(20) << '[';
+      for (size_t nIndex = 0; nIndex < arrayNumbers.Size(); ++nIndex)
+         ostr << (nIndex ? "," : "") << static_cast<const Number&>(static_cast<const Array&>(arrayNumbers)[nIndex]).Value();
+      ostr << ']';
+      sIostream = ostr.str();
+   });
+
+   std::cout << "Writer, 1M numbers (a third each whole, short decimals, full precision)" << std::endl;
+   std::cout << "                   ms        MB" << std::endl;
+   std::cout << std::fixed
+             << "  shortest" << std::setw(11) << std::setprecision(1) << dShortest 
+             << std::setw(10) << std::setprecision(2) << sShortest.size() / (1024.0 * 1024) << std::endl
+             << "  iostream" << std::setw(11) << std::setprecision(1) << dIostream 
+             << std::setw(10) << std::setprecision(2) << sIostream.size() / (1024.0 * 1024) << std::endl;
+   std::cout << std::endl;
+}
+
+
+int main()
+{
+   // build with optimizations (make bench) for meaningful numbers
+   BenchParallel();
+   BenchNested();
+   BenchNumbers();
+   return 0;
+}
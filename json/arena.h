@@ -0,0 +1,138 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// Arena - a monotonic allocator. Allocation just bumps a pointer through 
+//  large blocks, and nothing is given back until Release() (or destruction),
+//  which frees every block at once. Not thread-safe.
+
+class Arena
+{
+public:
+   explicit Arena(size_t nFirstBlockSize = 4 * 1024);
+   ~Arena();
+
+   void* Allocate(size_t nSize, size_t nAlignment);
+
+   // frees everything ever allocated. anything still living in the arena must
+   //  have been destroyed (or never need destroying) first
+   void Release();
+
+   // total size of the blocks currently held
+   size_t Capacity() const;
+
+private:
+   Arena(const Arena&);               // not copyable
+   Arena& operator = (const Arena&);
+
+   struct Block
+   {
+      Block* pNext;
+      size_t nSize;
+   };
+
+   void* AllocateBlock(size_t nSize, size_t nAlignment);
+
+   Block* m_pBlocks;
+   char* m_pCur;
+   char* m_pEnd;
+   size_t m_nFirstBlockSize;
+   size_t m_nNextBlockSize;
+   size_t m_nCapacity;
+};
+
+
+/////////////////////////////////////////////////////////////////////////
+// ArenaAllocator - standard allocator adapter for Arena, so containers can 
+//  keep their storage there. Without an arena it's just the heap. Deallocation
+//  within an arena is a no-op.
+// Copying a container allocates the copy on the heap, so copies taken out of 
+//  an arena (i.e. out of a Document) are independent of it. As with std::pmr
+//  containers, a container constructed by moving takes the arena along, but
+//  assignment & swapping never change a container's arena: between different
+//  arenas the contents are moved over one by one instead.
+// Elements are constructed through ArenaConstruct (below), found by argument 
+//  dependent lookup, so types can tell moves within an arena from moves out.
+
+template <typename ValueTypeT>
+class ArenaAllocator
+{
+public:
+   typedef ValueTypeT value_type;
+
+   typedef std::false_type propagate_on_container_copy_assignment;
+   typedef std::false_type propagate_on_container_move_assignment;
+   typedef std::false_type propagate_on_container_swap;
+
+   ArenaAllocator(Arena* pArena = 0);
+
+   template <typename OtherTypeT>
+   ArenaAllocator(const ArenaAllocator<OtherTypeT>& allocator);
+
+   ValueTypeT* allocate(size_t n);
+   void deallocate(ValueTypeT* p, size_t n);
+
+   template <typename OtherTypeT, typename... ArgumentTypesT>
+   void construct(OtherTypeT* p, ArgumentTypesT&&... arguments);
+
+   ArenaAllocator select_on_container_copy_construction() const;
+
+   Arena* GetArena() const;
+
+private:
+   Arena* m_pArena;
+};
+
+template <typename ValueTypeT, typename OtherTypeT>
+bool operator == (const ArenaAllocator<ValueTypeT>& a, const ArenaAllocator<OtherTypeT>& b);
+
+template <typename ValueTypeT, typename OtherTypeT>
+bool operator != (const ArenaAllocator<ValueTypeT>& a, const ArenaAllocator<OtherTypeT>& b);
+
+// constructs a container element at p, in storage belonging to pArena (0 for the 
+//  heap). plain construction by default; overloaded by UnknownElement & 
+//  Object::Member, which keep their arena boxes when moved within the arena
+template <typename ValueTypeT, typename... ArgumentTypesT>
+void ArenaConstruct(Arena* pArena, ValueTypeT* p, ArgumentTypesT&&... arguments);
+
+
+} // End namespace
+
+
+#include "arena.inl"
@@ -0,0 +1,187 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace json
+{
+
+
+/////////////////
+// Arena members
+
+inline Arena::Arena(size_t nFirstBlockSize) :
+   m_pBlocks(0),
+   m_pCur(0),
+   m_pEnd(0),
+   m_nFirstBlockSize(nFirstBlockSize),
+   m_nNextBlockSize(nFirstBlockSize),
+   m_nCapacity(0)
+{}
+
+inline Arena::~Arena()
+{
+   Release();
+}
+
+inline void* Arena::Allocate(size_t nSize, size_t nAlignment)
+{
+   if (m_pCur == 0)
+      return AllocateBlock(nSize, nAlignment);
+
+   // round up to the alignment within the current block, if it fits. blocks needn't
+   //  end on an alignment boundary, so rounding up can take us past the end
+   size_t nMisalignment = reinterpret_cast<size_t>(m_pCur) & (nAlignment - 1);
+   size_t nPadding = nMisalignment ? nAlignment - nMisalignment : 0;
+   size_t nLeft = static_cast<size_t>(m_pEnd - m_pCur);
+   if (nPadding > nLeft || nSize > nLeft - nPadding)
+      return AllocateBlock(nSize, nAlignment);
+
+   char* p = m_pCur + nPadding;
+   m_pCur = p + nSize;
+   return p;
+}
+
+inline void* Arena::AllocateBlock(size_t nSize, size_t nAlignment)
+{
+   // blocks double in size (to a point) so big documents need few of them. requests
+   //  too big for that get a block all their own
+   const size_t nMaxBlockSize = 1024 * 1024;
+   size_t nHeader = (sizeof(Block) + nAlignment - 1) & ~(nAlignment - 1);
+   size_t nBlockSize = std::max(m_nNextBlockSize, nHeader + nSize);
+
+   Block* pBlock = static_cast<Block*>(std::malloc(nBlockSize));
+   if (pBlock == 0)
+      throw std::bad_alloc();
+   pBlock->pNext = m_pBlocks;
+   pBlock->nSize = nBlockSize;
+   m_pBlocks = pBlock;
+   m_nCapacity += nBlockSize;
+   m_nNextBlockSize = std::min(m_nNextBlockSize * 2, nMaxBlockSize);
+
+   char* p = reinterpret_cast<char*>(pBlock) + nHeader;
+   char* pEnd = reinterpret_cast<char*>(pBlock) + nBlockSize;
+
+   // keep bumping through whichever block has more room left
+   if (m_pCur == 0 || pEnd - (p + nSize) > m_pEnd - m_pCur)
+   {
+      m_pCur = p + nSize;
+      m_pEnd = pEnd;
+   }
+   return p;
+}
+
+inline void Arena::Release()
+{
+   while (m_pBlocks)
+   {
+      Block* pNext = m_pBlocks->pNext;
+      std::free(m_pBlocks);
+      m_pBlocks = pNext;
+   }
+
+   m_pCur = m_pEnd = 0;
+   m_nNextBlockSize = m_nFirstBlockSize;
+   m_nCapacity = 0;
+}
+
+inline size_t Arena::Capacity() const
+{
+   return m_nCapacity;
+}
+
+
+//////////////////////////
+// ArenaAllocator members
+
+template <typename ValueTypeT>
+ArenaAllocator<ValueTypeT>::ArenaAllocator(Arena* pArena) :
+   m_pArena(pArena) {}
+
+template <typename ValueTypeT>
+template <typename OtherTypeT>
+ArenaAllocator<ValueTypeT>::ArenaAllocator(const ArenaAllocator<OtherTypeT>& allocator) :
+   m_pArena(allocator.GetArena()) {}
+
+template <typename ValueTypeT>
+ValueTypeT* ArenaAllocator<ValueTypeT>::allocate(size_t n)
+{
+   if (m_pArena)
+      return static_cast<ValueTypeT*>(m_pArena->Allocate(n * sizeof(ValueTypeT), alignof(ValueTypeT)));
+   return static_cast<ValueTypeT*>(::operator new(n * sizeof(ValueTypeT)));
+}
+
+template <typename ValueTypeT>
+void ArenaAllocator<ValueTypeT>::deallocate(ValueTypeT* p, size_t)
+{
+   // arena memory is only given back all at once
+   if (m_pArena == 0)
+      ::operator delete(p);
+}
+
+template <typename ValueTypeT>
+template <typename OtherTypeT, typename... ArgumentTypesT>
+void ArenaAllocator<ValueTypeT>::construct(OtherTypeT* p, ArgumentTypesT&&... arguments)
+{
+   ArenaConstruct(m_pArena, p, std::forward<ArgumentTypesT>(arguments)...);
+}
+
+template <typename ValueTypeT>
+ArenaAllocator<ValueTypeT> ArenaAllocator<ValueTypeT>::select_on_container_copy_construction() const
+{
+   return ArenaAllocator();
+}
+
+template <typename ValueTypeT>
+Arena* ArenaAllocator<ValueTypeT>::GetArena() const
+{
+   return m_pArena;
+}
+
+template <typename ValueTypeT, typename OtherTypeT>
+bool operator == (const ArenaAllocator<ValueTypeT>& a, const ArenaAllocator<OtherTypeT>& b)
+{
+   return a.GetArena() == b.GetArena();
+}
+
+template <typename ValueTypeT, typename OtherTypeT>
+bool operator != (const ArenaAllocator<ValueTypeT>& a, const ArenaAllocator<OtherTypeT>& b)
+{
+   return a.GetArena() != b.GetArena();
+}
+
+template <typename ValueTypeT, typename... ArgumentTypesT>
+void ArenaConstruct(Arena*, ValueTypeT* p, ArgumentTypesT&&... arguments)
+{
+   ::new (static_cast<void*>(p)) ValueTypeT(std::forward<ArgumentTypesT>(arguments)...);
+}
+
+
+} // End namespace
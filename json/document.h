@@ -0,0 +1,103 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include "arena.h"
+#include "elements.h"
+#include "names.h"
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// Document - owns a tree along with the arena its nodes are allocated from.
+//  Reading into a Document (Reader::Read(Document&, ...)) puts the element 
+//  boxes, array storage & object members in the arena, so parsing is mostly 
+//  pointer bumping and teardown frees a handful of blocks rather than every 
+//  node. Strings too long for std::string's internal buffer still use the heap
+//  (String holds a plain std::string), as do member names.
+//
+//  Document document;
+//  Reader::ReadFile(document, "invoices.json");
+//  String strCompany = document["Invoices"][1]["Customer"]["Company"];
+//
+// Elements copied or moved out of a document (into a standalone element, an
+//  Array/Object outside the arena, or a whole Array/Object move-constructed 
+//  from one in the document) are copied onto the heap, so they're independent
+//  of it:
+//
+//  UnknownElement elemItems = std::move(document["Items"]);
+//  Array arrayItems(std::move(static_cast<Array&>(document["Items"])));
+//
+// Given a NameTable, a document interns the member names read into it, so a
+//  document reused for similar records (or several documents sharing one 
+//  thread-safe table) keeps sharing names. Without one, names aren't interned.
+
+class Document
+{
+public:
+   Document();
+   explicit Document(NameTable& names);   // must outlive the document
+   ~Document();
+
+   UnknownElement& Root();
+   const UnknownElement& Root() const;
+
+   // shortcuts to Root()[...]
+   UnknownElement& operator[] (const std::string& key);
+   const UnknownElement& operator[] (const std::string& key) const;
+   UnknownElement& operator[] (size_t index);
+   const UnknownElement& operator[] (size_t index) const;
+
+   // for building elements in the document by hand: Object(document.GetArena())...
+   Arena& GetArena();
+
+   // where member names read into the document are interned, or 0 if they aren't
+   NameTable* GetNames();
+
+   // destroys the tree & releases the arena. only what the tree holds outside the 
+   //  arena (strings, names, elements assigned in from elsewhere) is destroyed one
+   //  by one; the rest goes with the arena
+   void Clear();
+
+private:
+   Document(const Document&);               // not copyable
+   Document& operator = (const Document&);
+
+   Arena m_Arena;          // declared first, so it outlives the tree
+   NameTable* m_pNames;
+   UnknownElement m_Root;
+};
+
+
+} // End namespace
+
+
+#include "document.inl"
@@ -0,0 +1,68 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+namespace json
+{
+
+
+inline Document::Document() : m_pNames(0) {}
+inline Document::Document(NameTable& names) : m_pNames(&names) {}
+
+inline Document::~Document()
+{
+   Clear();
+}
+
+inline UnknownElement& Document::Root()                  { return m_Root; }
+inline const UnknownElement& Document::Root() const      { return m_Root; }
+
+inline UnknownElement& Document::operator[] (const std::string& key)               { return m_Root[key]; }
+inline const UnknownElement& Document::operator[] (const std::string& key) const   { return m_Root[key]; }
+inline UnknownElement& Document::operator[] (size_t index)                         { return m_Root[index]; }
+inline const UnknownElement& Document::operator[] (size_t index) const             { return m_Root[index]; }
+
+inline Arena& Document::GetArena()
+{
+   return m_Arena;
+}
+
+inline NameTable* Document::GetNames()
+{
+   return m_pNames;
+}
+
+inline void Document::Clear()
+{
+   // the tree has to go before the memory under it
+   m_Root.Abandon();
+   m_Arena.Release();
+}
+
+
+} // End namespace
@@ -29,10 +29,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
-#include <deque>
-#include <list>
+#include "arena.h"
+#include "names.h"
+#include <atomic>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 /*  
 
@@ -85,6 +87,46 @@ public:
 
 
 
+/////////////////////////////////////////////////////////////////////////////////
+// TrivialType_T - class template for encapsulates a simple data type, such as
+//  a string, number, or boolean. Provides implicit const & noncost cast operators
+//  for that type, allowing "DataTypeT type = trivialType;"
+
+
+template <typename DataTypeT>
+class TrivialType_T
+{
+public:
+   TrivialType_T(const DataTypeT& t = DataTypeT());
+   TrivialType_T(DataTypeT&& t);
+
+   operator DataTypeT&();
+   operator const DataTypeT&() const;
+
+   DataTypeT& Value();
+   const DataTypeT& Value() const;
+
+   bool operator == (const TrivialType_T<DataTypeT>& trivial) const;
+
+   void Swap(TrivialType_T<DataTypeT>& trivial);
+
+private:
+   DataTypeT m_tValue;
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Null - doesn't do much of anything but satisfy the JSON spec. It is the default
+//  element type of UnknownElement
+
+class Null
+{
+public:
+   bool operator == (const Null& trivial) const;
+};
+
+
 /////////////////////////////////////////////////////////////////////////
 // UnknownElement - provides a typesafe surrogate for any of the JSON-
 //  sanctioned element types. This class allows the Array and Object
@@ -98,6 +140,20 @@ public:
 //  element accesses can be chained together, allowing the following
 //  (when document structure is well-known):
 //  String str = objInvoices[1]["Customer"]["Company"];
+// Copies are cheap: strings, arrays & objects are shared (copy-on-write)
+//  between an element & its copies, and only what is written to through a 
+//  non-const cast, operator [] or Accept gets duplicated (one level at a
+//  time, so the rest of the subtree stays shared). Reference counts are 
+//  atomic, so copies can go to other threads.
+// References stay valid until the element they came from is reassigned or
+//  destroyed, with two catches (much as with C++03's copy-on-write std::string):
+//  - once the element has been copied, write through it rather than through a
+//    non-const reference taken before the copy, which could reach the copies.
+//    (the first copy after a write doesn't share the levels written to, so 
+//    elem["Self"] = elem & the like are safe; later copies share them again)
+//  - a const reference taken before a copy shows the contents as they were
+//    before the next write through the element, not the new ones, & is good
+//    until the write after that (until then, the element keeps the old ones).
 
 
 class UnknownElement
@@ -112,9 +168,47 @@ public:
    UnknownElement(const String& string);
    UnknownElement(const Null& null);
 
+   // moving takes over the other element's contents (subtree & all) without copying
+   //  them. the source is left a Null. contents in an arena (a Document's) are the 
+   //  exception: moving them anywhere but around their own arena copies them onto
+   //  the heap, so the result never outlives its memory. since that copy can throw,
+   //  the moves (& Swap) aren't noexcept; Array & Object grow their storage without
+   //  relying on them, so they're never copied on that account
+   UnknownElement(UnknownElement&& unknown);
+   UnknownElement(Object&& object);
+   UnknownElement(Array&& array);
+   UnknownElement(String&& string);
+
+   // arena-backed elements. an Object/Array constructed with an arena is boxed in the
+   //  same arena when moved into an UnknownElement; strings need to be told
+   UnknownElement(const String& string, Arena& arena);
+
    ~UnknownElement();
 
    UnknownElement& operator = (const UnknownElement& unknown);
+   UnknownElement& operator = (UnknownElement&& unknown);
+
+   void Swap(UnknownElement& unknown);
+
+   // which of the element types we hold
+   enum ElementType
+   {
+      NULL_ELEMENT,
+      BOOLEAN_ELEMENT,
+      NUMBER_ELEMENT,
+      STRING_ELEMENT,
+      ARRAY_ELEMENT,
+      OBJECT_ELEMENT
+   };
+
+   // O(1) type queries, for checking before casting rather than catching
+   ElementType Type() const;
+   bool IsNull() const;
+   bool IsBoolean() const;
+   bool IsNumber() const;
+   bool IsString() const;
+   bool IsArray() const;
+   bool IsObject() const;
 
    // implicit cast to actual element type. throws on failure
    operator const Object& () const;
@@ -148,19 +242,22 @@ public:
    bool operator == (const UnknownElement& element) const;
 
 private:
-   class Imp;
+   // casts are a type check, then straight to the value (or box) we hold
+   template <typename ElementTypeT>
+   static ElementType TypeOf();
 
    template <typename ElementTypeT>
-   class Imp_T;
+   const ElementTypeT& Get() const;
 
-   class CastVisitor;
-   class ConstCastVisitor;
-   
    template <typename ElementTypeT>
-   class CastVisitor_T;
+   ElementTypeT& Get();
 
+   // const access that doesn't pin the box, for callers that are done with the
+   //  reference before returning (Writer)
    template <typename ElementTypeT>
-   class ConstCastVisitor_T;
+   const ElementTypeT& Peek() const;
+
+   void Peek(ConstVisitor& visitor) const;
 
    template <typename ElementTypeT>
    const ElementTypeT& CastTo() const;
@@ -168,22 +265,114 @@ private:
    template <typename ElementTypeT>
    ElementTypeT& ConvertTo();
 
-   Imp* m_pImp;
+   friend class Reader;
+   friend class PushReader;
+   friend class Writer;
+   friend class Object;
+   friend class Array;
+   friend class Document;
+
+   // containers in an arena construct their elements through this, which moves the
+   //  arena box along when the element stays in the arena
+   friend void ArenaConstruct(Arena* pArena, UnknownElement* p, UnknownElement&& unknown);
+   UnknownElement(UnknownElement&& unknown, Arena* pArena);
+
+   // empties us out, then creates an empty container/string in the arena (or on the
+   //  heap, if there isn't one). unlike the non-const casts, the result can be shared
+   Object& EmplaceObject(Arena* pArena);
+   Array& EmplaceArray(Arena* pArena);
+   String& EmplaceString(Arena* pArena);
+
+   // the box around a string/array/object. heap boxes are reference counted & shared 
+   //  by copies, until one of them is written to
+   template <typename ElementTypeT>
+   struct Shared_T;
+
+   template <typename ElementTypeT, typename... ArgumentTypesT>
+   static Shared_T<ElementTypeT>* New(Arena* pArena, ArgumentTypesT&&... arguments);
+
+   template <typename ElementTypeT>
+   static Shared_T<ElementTypeT>* Share(Shared_T<ElementTypeT>* pShared, bool bArena);
+
+   template <typename ElementTypeT>
+   static const ElementTypeT& Pin(Shared_T<ElementTypeT>* pShared);
+
+   template <typename ElementTypeT>
+   ElementTypeT& Unshare(Shared_T<ElementTypeT>*& pShared);
+
+   template <typename ElementTypeT>
+   void Release(Shared_T<ElementTypeT>* pShared);
+
+   // the arena our box is in, or 0 if it's on the heap (or we have no box)
+   Arena* GetArena() const;
+
+   void Copy(const UnknownElement& unknown);
+   void Take(UnknownElement& unknown);
+   void MoveFrom(UnknownElement& unknown, Arena* pArena);
+   void Exchange(UnknownElement& unknown);
+   void Destroy();
+
+   // like Destroy, for when the arena is about to be released anyway: what's in 
+   //  the arena is left as it is, & only what it holds elsewhere (heap boxes, 
+   //  names, strings, object indexes) is let go of. Abandon leaves us a Null;
+   //  Forget doesn't even do that, so it's only for elements in the arena, which 
+   //  go with it (& whose memory is then best left alone)
+   void Abandon();
+   void Forget();
+
+   // the trivial types live right here; the others are too big (or aren't even
+   //  complete yet), so they get boxed
+   ElementType m_Type;
+   bool m_bArena;          // is the box (if any) allocated in an arena?
+   union
+   {
+      Null m_Null;
+      Boolean m_Boolean;
+      Number m_Number;
+      Shared_T<String>* m_pString;
+      Shared_T<Array>* m_pArray;
+      Shared_T<Object>* m_pObject;
+   };
 };
 
 
 /////////////////////////////////////////////////////////////////////////////////
-// Array - mimics std::deque<UnknownElement>. The array contents are effectively 
+// Array - mimics std::vector<UnknownElement>. The array contents are effectively 
 //  heterogeneous thanks to the ElementUnknown class. push_back has been replaced 
-//  by more generic insert functions.
+//  by more generic insert functions. Like std::vector, Insert, Erase & growth 
+//  invalidate iterators & references to elements.
+// An array of nothing but numbers can also be "packed" into a plain double[]
+//  (Reader does this automatically), a fraction of the size, with Numbers() 
+//  giving direct access. Element access (iterators, operator[]...) unpacks it 
+//  again: non-const access for good, const access into a cache alongside the
+//  numbers, so concurrent readers are safe. Non-const Numbers() & Pack() drop
+//  that cache (writes through the numbers would leave it stale), invalidating
+//  any iterators & references const access handed out.
 
 class Array
 {
 public:
-   typedef std::deque<UnknownElement> Elements;
+   typedef std::vector<UnknownElement, ArenaAllocator<UnknownElement> > Elements;
+   typedef std::vector<double, ArenaAllocator<double> > Doubles;
    typedef Elements::iterator iterator;
    typedef Elements::const_iterator const_iterator;
 
+   Array();
+   explicit Array(Arena& arena);
+   Array(const Array& array);
+
+   // an array moved out of an arena (a Document's) is copied onto the heap, like
+   //  any element moved out of one, so it doesn't depend on the arena
+   Array(Array&& array);
+
+   // moving into an array in a different arena (or the heap) moves the elements 
+   //  over one by one, rather than taking the other array's storage
+   Array& operator = (const Array& array);
+   Array& operator = (Array&& array);
+
+   // the arena the elements are stored in, or 0 for the heap
+   Arena* GetArena() const;
+
    iterator Begin();
    iterator End();
    const_iterator Begin() const;
@@ -191,9 +380,21 @@ public:
    
    iterator Insert(const UnknownElement& element, iterator itWhere);
    iterator Insert(const UnknownElement& element);
+   iterator Insert(UnknownElement&& element, iterator itWhere);
+   iterator Insert(UnknownElement&& element);
+
+   // constructs the element right in the array, from anything UnknownElement can be
+   //  constructed from
+   template <typename ElementTypeT>
+   iterator Emplace(ElementTypeT&& element, iterator itWhere);
+   template <typename ElementTypeT>
+   iterator Emplace(ElementTypeT&& element);
+
    iterator Erase(iterator itWhere);
    void Resize(size_t newSize);
+   void Reserve(size_t nCapacity);
    void Clear();
+   void Swap(Array& array);
 
    size_t Size() const;
    bool Empty() const;
@@ -203,31 +404,114 @@ public:
 
    bool operator == (const Array& array) const;
 
+   // packs the array if every element is a number. returns whether it's packed
+   bool Pack();
+   bool IsPacked() const;
+
+   // the packed numbers (Size() of them), or 0 if not packed. never 0 for a packed
+   //  array, even an empty one
+   double* Numbers();
+   const double* Numbers() const;
+
 private:
-   Elements m_Elements;
+   friend class Reader;
+   friend class UnknownElement;
+
+   // moves the array into pArena (0 for the heap): takes its storage if it's 
+   //  already there, or else moves the elements over one by one
+   Array(Array&& array, Arena* pArena);
+
+   enum State
+   {
+      ELEMENTS,         // m_Elements only
+      PACKED,           // m_Numbers only
+      PACKED_FILLING,   // m_Numbers, while one const reader fills m_Elements
+      PACKED_CACHED     // m_Numbers, plus the same in m_Elements for const access
+   };
+
+   // puts an element appended at the end in at itWhere instead
+   iterator MoveBack(iterator itWhere);
+
+   // emplace_back, resize & reserve would copy the elements over when growing 
+   //  std::vector, since their moves can throw. these grow it by moving them 
+   //  within our arena (or the heap) instead, which never copies
+   template <typename... ArgumentTypesT>
+   void EmplaceBack(ArgumentTypesT&&... arguments);
+   void Grow(size_t nSize);
+   void Reallocate(size_t nCapacity);
+
+   // non-const: back to elements for good. const: fill the element cache
+   void Unpack();
+   void UnpackCache() const;
+   void CopyFrom(const Array& array);
+
+   // see UnknownElement's. only for an array with its storage in an arena
+   void Forget();
+
+   // what Numbers() gives for an empty packed array, which has no storage to point to
+   static double* NoNumbers();
+
+   mutable Elements m_Elements;     // mutable for the const cache
+   Doubles m_Numbers;
+   mutable std::atomic<int> m_nState;
 };
 
 
 /////////////////////////////////////////////////////////////////////////////////
 // Object - mimics std::map<std::string, UnknownElement>. The member value 
 //  contents are effectively heterogeneous thanks to the UnknownElement class
+// Members are stored contiguously, in insertion order. Small objects are 
+//  searched linearly; past a handful of members a hash index is kept as well, 
+//  so lookups stay O(1). Members may be renamed or reordered through non-const
+//  iterators (it->name = ..., std::sort...), so once one has been handed out, a
+//  lookup the index can't answer is double-checked with a linear search, until
+//  operator [] next adds a member & the index is rebuilt.
+// Like std::vector, Insert, Erase & operator [] adding a member invalidate 
+//  iterators & references to members (Erase returns a valid iterator to the 
+//  member after the one erased).
 
 class Object
 {
 public:
    struct Member {
-      Member(const std::string& nameIn = std::string(), const UnknownElement& elementIn = UnknownElement());
+      Member(const Name& nameIn = Name(), const UnknownElement& elementIn = UnknownElement());
+      Member(Name&& nameIn, UnknownElement&& elementIn = UnknownElement());
+      Member(const Member& member) = default;
+      Member(Member&& member) = default;
+
+      Member& operator = (const Member& member) = default;
+      Member& operator = (Member&& member) = default;
 
       bool operator == (const Member& member) const;
 
-      std::string name;
+      Name name;
       UnknownElement element;
+
+   private:
+      // see UnknownElement's
+      friend void ArenaConstruct(Arena* pArena, Member* p, Member&& member);
+      Member(Member&& member, Arena* pArena);
    };
 
-   typedef std::list<Member> Members; // map faster, but does not preserve order
+   typedef std::vector<Member, ArenaAllocator<Member> > Members; // map faster, but does not preserve order
    typedef Members::iterator iterator;
    typedef Members::const_iterator const_iterator;
 
+   Object();
+   explicit Object(Arena& arena);
+   Object(const Object& object);
+
+   // like Array's, copied onto the heap if moved out of an arena
+   Object(Object&& object);
+
+   // moving into an object in a different arena (or the heap) moves the members 
+   //  over one by one, rather than taking the other object's storage
+   Object& operator = (const Object& object);
+   Object& operator = (Object&& object);
+
+   // the arena the members are stored in, or 0 for the heap
+   Arena* GetArena() const;
+
    bool operator == (const Object& object) const;
 
    iterator Begin();
@@ -241,58 +525,127 @@ public:
    iterator Find(const std::string& name);
    const_iterator Find(const std::string& name) const;
 
+   // quickest with a name already interned by the same table as ours
+   iterator Find(const Name& name);
+   const_iterator Find(const Name& name) const;
+
+   // same, without building a std::string first
+   iterator Find(const char* name);
+   const_iterator Find(const char* name) const;
+   iterator Find(const char* name, size_t nLength);
+   const_iterator Find(const char* name, size_t nLength) const;
+
    iterator Insert(const Member& member);
    iterator Insert(const Member& member, iterator itWhere);
+   iterator Insert(Member&& member);
+   iterator Insert(Member&& member, iterator itWhere);
+
+   // constructs the member right in the object. like Insert, throws if the name is taken
+   template <typename ElementTypeT>
+   iterator Emplace(const Name& name, ElementTypeT&& element, iterator itWhere);
+   template <typename ElementTypeT>
+   iterator Emplace(const Name& name, ElementTypeT&& element);
+
    iterator Erase(iterator itWhere);
    void Clear();
+   void Swap(Object& object);
 
    UnknownElement& operator [](const std::string& name);
    const UnknownElement& operator [](const std::string& name) const;
+   UnknownElement& operator [](const char* name);
+   const UnknownElement& operator [](const char* name) const;
 
 private:
-   class Finder;
+   friend class Reader;
+   friend class PushReader;
+   friend class UnknownElement;
 
-   Members m_Members;
-};
+   // see Array's
+   Object(Object&& object, Arena* pArena);
 
+   // open addressing (linear probing) hash table of member positions
+   class Index
+   {
+   public:
+      static const size_t NOT_FOUND = static_cast<size_t>(-1);
 
-/////////////////////////////////////////////////////////////////////////////////
-// TrivialType_T - class template for encapsulates a simple data type, such as
-//  a string, number, or boolean. Provides implicit const & noncost cast operators
-//  for that type, allowing "DataTypeT type = trivialType;"
+      Index();
 
+      void Build(const Members& members);
+      void Clear();
+      void Swap(Index& index);
+      bool Built() const;
 
-template <typename DataTypeT>
-class TrivialType_T
-{
-public:
-   TrivialType_T(const DataTypeT& t = DataTypeT());
+      size_t Find(const Members& members, const char* name, size_t nLength, size_t nHash) const;
+      size_t Find(const Members& members, const Name& name) const;
 
-   operator DataTypeT&();
-   operator const DataTypeT&() const;
+      // both keep the positions of the members after nPosition up to date
+      void Insert(size_t nPosition, size_t nHash);
+      void Erase(size_t nPosition, size_t nHash);
 
-   DataTypeT& Value();
-   const DataTypeT& Value() const;
+   private:
+      struct Slot
+      {
+         size_t nHash;
+         size_t nPosition;       // NOT_FOUND if unused
+      };
 
-   bool operator == (const TrivialType_T<DataTypeT>& trivial) const;
+      void Add(size_t nPosition, size_t nHash);
+      void Grow();
 
-private:
-   DataTypeT m_tValue;
-};
+      std::vector<Slot> m_Slots;
+      size_t m_nSize;
+   };
 
+   // objects this big get an index
+   enum { INDEX_THRESHOLD = 16 };
 
+   iterator Indexed(iterator itMember);
 
-/////////////////////////////////////////////////////////////////////////////////
-// Null - doesn't do much of anything but satisfy the JSON spec. It is the default
-//  element type of UnknownElement
+   // looks a member up without handing out an iterator, so nothing can be renamed
+   //  through the result. NOT_FOUND if there's no such member
+   size_t Position(const char* name, size_t nLength) const;
+   size_t Position(const Name& name) const;
 
-class Null
-{
-public:
-   bool operator == (const Null& trivial) const;
+   // a non-const iterator is getting out, through which members could be renamed
+   //  or reordered, so the index can't be trusted to have every member any more
+   iterator Exposed(iterator it);
+
+   // adds a member whose name the caller has already looked up, without looking again
+   iterator Append(Member&& member);
+
+   // puts a member appended at the end in at itWhere instead. the ones in the way
+   //  are moved up by swapping, which keeps arena boxes in their arena
+   iterator MoveBack(iterator itWhere);
+   static void Exchange(Member& a, Member& b);
+
+   // see Array's
+   template <typename... ArgumentTypesT>
+   void EmplaceBack(ArgumentTypesT&&... arguments);
+   void Forget();
+
+   Members m_Members;
+   Index m_Index;
+   bool m_bExposed;        // has a non-const iterator been handed out since the index was built?
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////
+// swap overloads, so swap(a, b) (and the standard algorithms) trade contents 
+//  instead of copying
+
+void swap(UnknownElement& a, UnknownElement& b);
+void swap(Array& a, Array& b);
+void swap(Object& a, Object& b);
+
+// see ArenaAllocator
+void ArenaConstruct(Arena* pArena, UnknownElement* p, UnknownElement&& unknown);
+void ArenaConstruct(Arena* pArena, Object::Member* p, Object::Member&& member);
+
+template <typename DataTypeT>
+void swap(TrivialType_T<DataTypeT>& a, TrivialType_T<DataTypeT>& b);
+
+
 } // End namespace
 
 
@@ -30,8 +30,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "visitor.h"
 #include "reader.h"
 #include <cassert>
+#include <cstring>
 #include <algorithm>
 #include <map>
+#include <new>
+#include <thread>
+#include <utility>
 
 /*  
 
@@ -51,94 +55,99 @@ inline Exception::Exception(const std::string& sMessage) :
 /////////////////////////
 // UnknownElement members
 
-class UnknownElement::Imp
-{
-public:
-   virtual ~Imp() {}
-   virtual Imp* Clone() const = 0;
-
-   virtual bool Compare(const Imp& imp) const = 0;
-
-   virtual void Accept(ConstVisitor& visitor) const = 0;
-   virtual void Accept(Visitor& visitor) = 0;
-};
-
-
 template <typename ElementTypeT>
-class UnknownElement::Imp_T : public UnknownElement::Imp
+struct UnknownElement::Shared_T
 {
-public:
-   Imp_T(const ElementTypeT& element) : m_Element(element) {}
-   virtual Imp* Clone() const { return new Imp_T<ElementTypeT>(*this); }
-
-   virtual void Accept(ConstVisitor& visitor) const { visitor.Visit(m_Element); }
-   virtual void Accept(Visitor& visitor) { visitor.Visit(m_Element); }
+   template <typename... ArgumentTypesT>
+   Shared_T(Arena* pArena, ArgumentTypesT&&... arguments) :
+      m_Element(std::forward<ArgumentTypesT>(arguments)...),
+      m_nReferences(1),
+      m_bWritten(false),
+      m_bReferenced(false),
+      m_pArena(pArena),
+      m_pRetained(0) {}
+
+   ~Shared_T()
+   {
+      Retain(0);
+   }
 
-   virtual bool Compare(const Imp& imp) const
+   // lets go of the retained box (if any), & holds on to another instead
+   void Retain(Shared_T* pRetained)
    {
-      ConstCastVisitor_T<ElementTypeT> castVisitor;
-      imp.Accept(castVisitor);
-      return castVisitor.m_pElement &&
-             m_Element == *castVisitor.m_pElement;
+      if (m_pRetained && m_pRetained->m_nReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+         delete m_pRetained;
+      m_pRetained = pRetained;
    }
 
-private:
    ElementTypeT m_Element;
+   std::atomic<size_t> m_nReferences;
+   std::atomic<bool> m_bWritten;    // true from a write until the next copy
+   std::atomic<bool> m_bReferenced; // true once a const reference into m_Element has been handed out
+   Arena* m_pArena;                 // the arena we're allocated in, or 0 for the heap
+   Shared_T* m_pRetained;           // the box we were copied out of by a write, until the next write
 };
 
 
-class UnknownElement::ConstCastVisitor : public ConstVisitor
-{
-   virtual void Visit(const Array& array) {}
-   virtual void Visit(const Object& object) {}
-   virtual void Visit(const Number& number) {}
-   virtual void Visit(const String& string) {}
-   virtual void Visit(const Boolean& boolean) {}
-   virtual void Visit(const Null& null) {}
-};
-
-template <typename ElementTypeT>
-class UnknownElement::ConstCastVisitor_T : public ConstCastVisitor
-{
-public:
-   ConstCastVisitor_T() : m_pElement(0) {}
-   virtual void Visit(const ElementTypeT& element) { m_pElement = &element; } // we don't know what this is, but it overrides one of the base's no-op functions
-   const ElementTypeT* m_pElement;
-};
-
-
-class UnknownElement::CastVisitor : public Visitor
-{
-   virtual void Visit(Array& array) {}
-   virtual void Visit(Object& object) {}
-   virtual void Visit(Number& number) {}
-   virtual void Visit(String& string) {}
-   virtual void Visit(Boolean& boolean) {}
-   virtual void Visit(Null& null) {}
-};
-
-template <typename ElementTypeT>
-class UnknownElement::CastVisitor_T : public CastVisitor
-{
-public:
-   CastVisitor_T() : m_pElement(0) {}
-   virtual void Visit(ElementTypeT& element) { m_pElement = &element; } // we don't know what this is, but it overrides one of the base's no-op functions
-   ElementTypeT* m_pElement;
-};
-
-
-
-
-inline UnknownElement::UnknownElement() :                               m_pImp( new Imp_T<Null>( Null() ) ) {}
-inline UnknownElement::UnknownElement(const UnknownElement& unknown) :  m_pImp( unknown.m_pImp->Clone()) {}
-inline UnknownElement::UnknownElement(const Object& object) :           m_pImp( new Imp_T<Object>(object) ) {}
-inline UnknownElement::UnknownElement(const Array& array) :             m_pImp( new Imp_T<Array>(array) ) {}
-inline UnknownElement::UnknownElement(const Number& number) :           m_pImp( new Imp_T<Number>(number) ) {}
-inline UnknownElement::UnknownElement(const Boolean& boolean) :         m_pImp( new Imp_T<Boolean>(boolean) ) {}
-inline UnknownElement::UnknownElement(const String& string) :           m_pImp( new Imp_T<String>(string) ) {}
-inline UnknownElement::UnknownElement(const Null& null) :               m_pImp( new Imp_T<Null>(null) ) {}
-
-inline UnknownElement::~UnknownElement()   { delete m_pImp; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<Object>()    { return OBJECT_ELEMENT; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<Array>()     { return ARRAY_ELEMENT; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<Number>()    { return NUMBER_ELEMENT; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<Boolean>()   { return BOOLEAN_ELEMENT; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<String>()    { return STRING_ELEMENT; }
+template <> inline UnknownElement::ElementType UnknownElement::TypeOf<Null>()      { return NULL_ELEMENT; }
+
+// these assume the type has already been checked
+template <> inline const Object& UnknownElement::Get<Object>() const    { return Pin(m_pObject); }
+template <> inline const Array& UnknownElement::Get<Array>() const      { return Pin(m_pArray); }
+template <> inline const Number& UnknownElement::Get<Number>() const    { return m_Number; }
+template <> inline const Boolean& UnknownElement::Get<Boolean>() const  { return m_Boolean; }
+template <> inline const String& UnknownElement::Get<String>() const    { return Pin(m_pString); }
+template <> inline const Null& UnknownElement::Get<Null>() const        { return m_Null; }
+
+template <> inline const Object& UnknownElement::Peek<Object>() const   { return m_pObject->m_Element; }
+template <> inline const Array& UnknownElement::Peek<Array>() const     { return m_pArray->m_Element; }
+template <> inline const Number& UnknownElement::Peek<Number>() const   { return m_Number; }
+template <> inline const Boolean& UnknownElement::Peek<Boolean>() const { return m_Boolean; }
+template <> inline const String& UnknownElement::Peek<String>() const   { return m_pString->m_Element; }
+template <> inline const Null& UnknownElement::Peek<Null>() const       { return m_Null; }
+
+// ...and writers get a box of their own
+template <> inline Object& UnknownElement::Get<Object>()                { return Unshare(m_pObject); }
+template <> inline Array& UnknownElement::Get<Array>()                  { return Unshare(m_pArray); }
+template <> inline Number& UnknownElement::Get<Number>()                { return m_Number; }
+template <> inline Boolean& UnknownElement::Get<Boolean>()              { return m_Boolean; }
+template <> inline String& UnknownElement::Get<String>()                { return Unshare(m_pString); }
+template <> inline Null& UnknownElement::Get<Null>()                    { return m_Null; }
+
+
+
+
+inline UnknownElement::UnknownElement() :                               m_Type(NULL_ELEMENT), m_bArena(false), m_Null() {}
+inline UnknownElement::UnknownElement(const UnknownElement& unknown) :  m_Type(NULL_ELEMENT), m_bArena(false) { Copy(unknown); }
+inline UnknownElement::UnknownElement(const Object& object) :           m_Type(OBJECT_ELEMENT), m_bArena(false), m_pObject( New<Object>(0, object) ) {}
+inline UnknownElement::UnknownElement(const Array& array) :             m_Type(ARRAY_ELEMENT), m_bArena(false), m_pArray( New<Array>(0, array) ) {}
+inline UnknownElement::UnknownElement(const Number& number) :           m_Type(NUMBER_ELEMENT), m_bArena(false), m_Number(number) {}
+inline UnknownElement::UnknownElement(const Boolean& boolean) :         m_Type(BOOLEAN_ELEMENT), m_bArena(false), m_Boolean(boolean) {}
+inline UnknownElement::UnknownElement(const String& string) :           m_Type(STRING_ELEMENT), m_bArena(false), m_pString( New<String>(0, string) ) {}
+inline UnknownElement::UnknownElement(const Null& null) :               m_Type(NULL_ELEMENT), m_bArena(false), m_Null(null) {}
+
+inline UnknownElement::UnknownElement(UnknownElement&& unknown) : m_Type(NULL_ELEMENT), m_bArena(false) { MoveFrom(unknown, 0); }
+inline UnknownElement::UnknownElement(UnknownElement&& unknown, Arena* pArena) : m_Type(NULL_ELEMENT), m_bArena(false) { MoveFrom(unknown, pArena); }
+inline UnknownElement::UnknownElement(Object&& object) :                m_Type(OBJECT_ELEMENT), m_bArena(object.GetArena() != 0), m_pObject( New<Object>(object.GetArena(), std::move(object), object.GetArena()) ) {}
+inline UnknownElement::UnknownElement(Array&& array) :                  m_Type(ARRAY_ELEMENT), m_bArena(array.GetArena() != 0), m_pArray( New<Array>(array.GetArena(), std::move(array), array.GetArena()) ) {}
+inline UnknownElement::UnknownElement(String&& string) :                m_Type(STRING_ELEMENT), m_bArena(false), m_pString( New<String>(0, std::move(string)) ) {}
+
+inline UnknownElement::UnknownElement(const String& string, Arena& arena) : m_Type(STRING_ELEMENT), m_bArena(true), m_pString( New<String>(&arena, string) ) {}
+
+inline UnknownElement::~UnknownElement()   { Destroy(); }
+
+inline UnknownElement::ElementType UnknownElement::Type() const   { return m_Type; }
+inline bool UnknownElement::IsNull() const                        { return m_Type == NULL_ELEMENT; }
+inline bool UnknownElement::IsBoolean() const                     { return m_Type == BOOLEAN_ELEMENT; }
+inline bool UnknownElement::IsNumber() const                      { return m_Type == NUMBER_ELEMENT; }
+inline bool UnknownElement::IsString() const                      { return m_Type == STRING_ELEMENT; }
+inline bool UnknownElement::IsArray() const                       { return m_Type == ARRAY_ELEMENT; }
+inline bool UnknownElement::IsObject() const                      { return m_Type == OBJECT_ELEMENT; }
 
 inline UnknownElement::operator const Object& () const    { return CastTo<Object>(); }
 inline UnknownElement::operator const Array& () const     { return CastTo<Array>(); }
@@ -159,17 +168,37 @@ inline UnknownElement& UnknownElement::operator = (const UnknownElement& unknown
    // always check for this
    if (&unknown != this)
    {
-      // we might be copying from a subtree of ourselves. delete the old imp
-      //  only after the clone operation is complete. yes, this could be made 
-      //  more efficient, but isn't worth the complexity
-      Imp* pOldImp = m_pImp;
-      m_pImp = unknown.m_pImp->Clone();
-      delete pOldImp;
+      // we might be copying from a subtree of ourselves. release the old value
+      //  only after the copy is complete
+      UnknownElement copy(unknown);
+      Destroy();
+      Take(copy);
+   }
+
+   return *this;
+}
+
+inline UnknownElement& UnknownElement::operator = (UnknownElement&& unknown)
+{
+   if (&unknown != this)
+   {
+      // same goes for moving: the source may live inside our old value
+      UnknownElement taken(std::move(unknown));
+      Destroy();
+      Take(taken);
    }
 
    return *this;
 }
 
+inline void UnknownElement::Swap(UnknownElement& unknown)
+{
+   // by moving, so neither ends up holding the other's arena box
+   UnknownElement temp(std::move(unknown));
+   unknown = std::move(*this);
+   *this = std::move(temp);
+}
+
 inline UnknownElement& UnknownElement::operator[] (const std::string& key)
 {
    // the people want an object. make us one if we aren't already
@@ -202,11 +231,9 @@ inline const UnknownElement& UnknownElement::operator[] (size_t index) const
 template <typename ElementTypeT>
 const ElementTypeT& UnknownElement::CastTo() const
 {
-   ConstCastVisitor_T<ElementTypeT> castVisitor;
-   m_pImp->Accept(castVisitor);
-   if (castVisitor.m_pElement == 0)
+   if (m_Type != TypeOf<ElementTypeT>())
       throw Exception("Bad cast");
-   return *castVisitor.m_pElement;
+   return Get<ElementTypeT>();
 }
 
 
@@ -214,26 +241,283 @@ const ElementTypeT& UnknownElement::CastTo() const
 template <typename ElementTypeT>
 ElementTypeT& UnknownElement::ConvertTo() 
 {
-   CastVisitor_T<ElementTypeT> castVisitor;
-   m_pImp->Accept(castVisitor);
-   if (castVisitor.m_pElement == 0)
-   {
-      // we're not the right type. fix it & try again
+   // we're not the right type? fix it
+   if (m_Type != TypeOf<ElementTypeT>())
       *this = ElementTypeT();
-      m_pImp->Accept(castVisitor);
-   }
+   return Get<ElementTypeT>();
+}
+
 
-   return *castVisitor.m_pElement;
+inline void UnknownElement::Accept(ConstVisitor& visitor) const
+{
+   switch (m_Type)
+   {
+      case NULL_ELEMENT:        visitor.Visit(m_Null); break;
+      case BOOLEAN_ELEMENT:     visitor.Visit(m_Boolean); break;
+      case NUMBER_ELEMENT:      visitor.Visit(m_Number); break;
+      case STRING_ELEMENT:      visitor.Visit(Get<String>()); break;
+      case ARRAY_ELEMENT:       visitor.Visit(Get<Array>()); break;
+      case OBJECT_ELEMENT:      visitor.Visit(Get<Object>()); break;
+   }
 }
 
+inline void UnknownElement::Peek(ConstVisitor& visitor) const
+{
+   switch (m_Type)
+   {
+      case NULL_ELEMENT:        visitor.Visit(m_Null); break;
+      case BOOLEAN_ELEMENT:     visitor.Visit(m_Boolean); break;
+      case NUMBER_ELEMENT:      visitor.Visit(m_Number); break;
+      case STRING_ELEMENT:      visitor.Visit(Peek<String>()); break;
+      case ARRAY_ELEMENT:       visitor.Visit(Peek<Array>()); break;
+      case OBJECT_ELEMENT:      visitor.Visit(Peek<Object>()); break;
+   }
+}
 
-inline void UnknownElement::Accept(ConstVisitor& visitor) const { m_pImp->Accept(visitor); }
-inline void UnknownElement::Accept(Visitor& visitor)            { m_pImp->Accept(visitor); }
+inline void UnknownElement::Accept(Visitor& visitor)
+{
+   switch (m_Type)
+   {
+      case NULL_ELEMENT:        visitor.Visit(m_Null); break;
+      case BOOLEAN_ELEMENT:     visitor.Visit(m_Boolean); break;
+      case NUMBER_ELEMENT:      visitor.Visit(m_Number); break;
+      case STRING_ELEMENT:      visitor.Visit(Get<String>()); break;
+      case ARRAY_ELEMENT:       visitor.Visit(Get<Array>()); break;
+      case OBJECT_ELEMENT:      visitor.Visit(Get<Object>()); break;
+   }
+}
 
 
 inline bool UnknownElement::operator == (const UnknownElement& element) const
 {
-   return m_pImp->Compare(*element.m_pImp);
+   if (m_Type != element.m_Type)
+      return false;
+
+   switch (m_Type)
+   {
+      // sharing a box settles it right away
+      case BOOLEAN_ELEMENT:     return m_Boolean == element.m_Boolean;
+      case NUMBER_ELEMENT:      return m_Number == element.m_Number;
+      case STRING_ELEMENT:      return m_pString == element.m_pString || m_pString->m_Element == element.m_pString->m_Element;
+      case ARRAY_ELEMENT:       return m_pArray == element.m_pArray || m_pArray->m_Element == element.m_pArray->m_Element;
+      case OBJECT_ELEMENT:      return m_pObject == element.m_pObject || m_pObject->m_Element == element.m_pObject->m_Element;
+      default:                  return true; // Null
+   }
+}
+
+
+inline Object& UnknownElement::EmplaceObject(Arena* pArena)
+{
+   Destroy();
+   m_pObject = pArena ? New<Object>(pArena, *pArena) : New<Object>(0);
+   m_Type = OBJECT_ELEMENT;
+   m_bArena = (pArena != 0);
+   return m_pObject->m_Element;
+}
+
+inline Array& UnknownElement::EmplaceArray(Arena* pArena)
+{
+   Destroy();
+   m_pArray = pArena ? New<Array>(pArena, *pArena) : New<Array>(0);
+   m_Type = ARRAY_ELEMENT;
+   m_bArena = (pArena != 0);
+   return m_pArray->m_Element;
+}
+
+inline String& UnknownElement::EmplaceString(Arena* pArena)
+{
+   Destroy();
+   m_pString = New<String>(pArena);
+   m_Type = STRING_ELEMENT;
+   m_bArena = (pArena != 0);
+   return m_pString->m_Element;
+}
+
+template <typename ElementTypeT, typename... ArgumentTypesT>
+UnknownElement::Shared_T<ElementTypeT>* UnknownElement::New(Arena* pArena, ArgumentTypesT&&... arguments)
+{
+   // arena boxes are never shared; they can't outlive the arena
+   if (pArena == 0)
+      return new Shared_T<ElementTypeT>(pArena, std::forward<ArgumentTypesT>(arguments)...);
+
+   void* p = pArena->Allocate(sizeof(Shared_T<ElementTypeT>), alignof(Shared_T<ElementTypeT>));
+   return new (p) Shared_T<ElementTypeT>(pArena, std::forward<ArgumentTypesT>(arguments)...);
+}
+
+template <typename ElementTypeT>
+UnknownElement::Shared_T<ElementTypeT>* UnknownElement::Share(Shared_T<ElementTypeT>* pShared, bool bArena)
+{
+   // copies always go on the heap, wherever the original lives. a box written to 
+   //  since its last copy isn't shared either, in case a reference from the write is
+   //  still being written through (elem["Self"] = elem), but the next copy can share
+   if (bArena == false && pShared->m_bWritten.load(std::memory_order_relaxed) == false)
+   {
+      pShared->m_nReferences.fetch_add(1, std::memory_order_relaxed);
+      return pShared;
+   }
+
+   Shared_T<ElementTypeT>* pCopy = New<ElementTypeT>(0, pShared->m_Element);
+   pShared->m_bWritten.store(false, std::memory_order_relaxed);
+   return pCopy;
+}
+
+template <typename ElementTypeT>
+const ElementTypeT& UnknownElement::Pin(Shared_T<ElementTypeT>* pShared)
+{
+   // a reference is getting out, so a write through any element sharing the box has
+   //  to keep it alive for a while (see Unshare)
+   if (pShared->m_bReferenced.load(std::memory_order_relaxed) == false)
+      pShared->m_bReferenced.store(true, std::memory_order_relaxed);
+   return pShared->m_Element;
+}
+
+template <typename ElementTypeT>
+ElementTypeT& UnknownElement::Unshare(Shared_T<ElementTypeT>*& pShared)
+{
+   // arena boxes are never shared, so they're always ours to write
+   if (m_bArena)
+      return pShared->m_Element;
+
+   // somebody wants to write. if anyone else can see the box, they get to keep it &
+   //  we take a copy (whose own children are shared in turn)
+   if (pShared->m_nReferences.load(std::memory_order_acquire) != 1)
+   {
+      Shared_T<ElementTypeT>* pCopy = New<ElementTypeT>(0, pShared->m_Element);
+
+      // const references into the box mustn't dangle the moment the other sharers let
+      //  go of it, so hang on to it until our next write
+      if (pShared->m_bReferenced.load(std::memory_order_relaxed))
+         pCopy->Retain(pShared);
+      else
+         Release(pShared);
+      pShared = pCopy;
+   }
+   else
+      pShared->Retain(0);
+
+   // the caller may hold on to the reference for a bit, so the next copy doesn't share
+   pShared->m_bWritten.store(true, std::memory_order_relaxed);
+   return pShared->m_Element;
+}
+
+template <typename ElementTypeT>
+void UnknownElement::Release(Shared_T<ElementTypeT>* pShared)
+{
+   // arena memory is released with the arena, but the contents still need destroying
+   if (m_bArena)
+      pShared->~Shared_T<ElementTypeT>();
+   else if (pShared->m_nReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete pShared;
+}
+
+inline void UnknownElement::Copy(const UnknownElement& unknown)
+{
+   // assumes we're holding nothing that needs releasing
+   switch (unknown.m_Type)
+   {
+      case NULL_ELEMENT:        new (&m_Null) Null(unknown.m_Null); break;
+      case BOOLEAN_ELEMENT:     new (&m_Boolean) Boolean(unknown.m_Boolean); break;
+      case NUMBER_ELEMENT:      new (&m_Number) Number(unknown.m_Number); break;
+      case STRING_ELEMENT:      m_pString = Share(unknown.m_pString, unknown.m_bArena); break;
+      case ARRAY_ELEMENT:       m_pArray = Share(unknown.m_pArray, unknown.m_bArena); break;
+      case OBJECT_ELEMENT:      m_pObject = Share(unknown.m_pObject, unknown.m_bArena); break;
+   }
+   m_Type = unknown.m_Type;
+   m_bArena = false;
+}
+
+inline Arena* UnknownElement::GetArena() const
+{
+   if (m_bArena == false)
+      return 0;
+
+   switch (m_Type)
+   {
+      case STRING_ELEMENT:      return m_pString->m_pArena;
+      case ARRAY_ELEMENT:       return m_pArray->m_pArena;
+      case OBJECT_ELEMENT:      return m_pObject->m_pArena;
+      default:                  return 0;
+   }
+}
+
+inline void UnknownElement::Take(UnknownElement& unknown)
+{
+   // steals the value (or its allocation) outright, leaving Null behind
+   switch (unknown.m_Type)
+   {
+      case NULL_ELEMENT:        new (&m_Null) Null(unknown.m_Null); break;
+      case BOOLEAN_ELEMENT:     new (&m_Boolean) Boolean(unknown.m_Boolean); break;
+      case NUMBER_ELEMENT:      new (&m_Number) Number(unknown.m_Number); break;
+      case STRING_ELEMENT:      m_pString = unknown.m_pString; break;
+      case ARRAY_ELEMENT:       m_pArray = unknown.m_pArray; break;
+      case OBJECT_ELEMENT:      m_pObject = unknown.m_pObject; break;
+   }
+   m_Type = unknown.m_Type;
+   m_bArena = unknown.m_bArena;
+   unknown.m_Type = NULL_ELEMENT;
+   unknown.m_bArena = false;
+}
+
+inline void UnknownElement::MoveFrom(UnknownElement& unknown, Arena* pArena)
+{
+   // an arena box can only stay in its own arena (i.e. be moved around within a 
+   //  container there). going anywhere else, it's copied out onto the heap
+   if (unknown.m_bArena && unknown.GetArena() != pArena)
+   {
+      Copy(unknown);
+      unknown.Destroy();
+   }
+   else
+      Take(unknown);
+}
+
+inline void UnknownElement::Exchange(UnknownElement& unknown)
+{
+   // trades boxes outright. only for elements in the same container (Array's & 
+   //  Object's shuffling), where an arena box is as much at home in one slot as another
+   UnknownElement temp;
+   temp.Take(unknown);
+   unknown.Take(*this);
+   Take(temp);
+}
+
+inline void ArenaConstruct(Arena* pArena, UnknownElement* p, UnknownElement&& unknown)
+{
+   ::new (static_cast<void*>(p)) UnknownElement(std::move(unknown), pArena);
+}
+
+inline void UnknownElement::Destroy()
+{
+   // the trivial types have nothing to clean up
+   switch (m_Type)
+   {
+      case STRING_ELEMENT:      Release(m_pString); break;
+      case ARRAY_ELEMENT:       Release(m_pArray); break;
+      case OBJECT_ELEMENT:      Release(m_pObject); break;
+      default:                  break;
+   }
+   m_Type = NULL_ELEMENT;
+   m_bArena = false;
+}
+
+inline void UnknownElement::Abandon()
+{
+   Forget();
+   m_Type = NULL_ELEMENT;
+   m_bArena = false;
+}
+
+inline void UnknownElement::Forget()
+{
+   // an arena box holds an arena container, so there's no need to destroy either;
+   //  just whatever they hold outside the arena. (arena boxes never retain others)
+   switch (m_Type)
+   {
+      case STRING_ELEMENT:      Release(m_pString); break;
+      case ARRAY_ELEMENT:       if (m_bArena) m_pArray->m_Element.Forget(); else Release(m_pArray); break;
+      case OBJECT_ELEMENT:      if (m_bArena) m_pObject->m_Element.Forget(); else Release(m_pObject); break;
+      default:                  break;
+   }
 }
 
 
@@ -242,45 +526,171 @@ inline bool UnknownElement::operator == (const UnknownElement& element) const
 // Object members
 
 
-inline Object::Member::Member(const std::string& nameIn, const UnknownElement& elementIn) :
+inline Object::Member::Member(const Name& nameIn, const UnknownElement& elementIn) :
    name(nameIn), element(elementIn) {}
 
+inline Object::Member::Member(Name&& nameIn, UnknownElement&& elementIn) :
+   name(std::move(nameIn)), element(std::move(elementIn)) {}
+
+inline Object::Member::Member(Member&& member, Arena* pArena) :
+   name(std::move(member.name)), element(std::move(member.element), pArena) {}
+
+inline void ArenaConstruct(Arena* pArena, Object::Member* p, Object::Member&& member)
+{
+   ::new (static_cast<void*>(p)) Object::Member(std::move(member), pArena);
+}
+
 inline bool Object::Member::operator == (const Member& member) const 
 {
    return name == member.name &&
           element == member.element;
 }
 
-class Object::Finder : public std::unary_function<Object::Member, bool>
+inline Object::Object() : m_bExposed(false) {}
+inline Object::Object(Arena& arena) : m_Members(ArenaAllocator<Member>(&arena)), m_bExposed(false) {}
+
+inline Object::Object(const Object& object) :
+   m_Members(object.m_Members),
+   m_bExposed(false)
+{
+   // the other index points into the other object
+   if (m_Members.size() >= INDEX_THRESHOLD)
+      m_Index.Build(m_Members);
+}
+
+inline Object::Object(Object&& object) : Object(std::move(object), 0) {}
+
+inline Object::Object(Object&& object, Arena* pArena) :
+   m_Members(ArenaAllocator<Member>(pArena)),
+   m_bExposed(false)
 {
-public:
-   Finder(const std::string& name) : m_name(name) {}
-   bool operator () (const Object::Member& member) {
-      return member.name == m_name;
+   if (object.GetArena() == pArena)
+   {
+      m_Members.swap(object.m_Members);
+      m_Index.Swap(object.m_Index);
+      std::swap(m_bExposed, object.m_bExposed);
+      return;
    }
 
-private:
-   std::string m_name;
-};
+   // moving the members over copies any arena boxes out of their arena
+   m_Members.reserve(object.m_Members.size());
+   for (iterator it = object.m_Members.begin(); it != object.m_Members.end(); ++it)
+      m_Members.push_back(std::move(*it));
+   if (m_Members.size() >= INDEX_THRESHOLD)
+      m_Index.Build(m_Members);
+   object.Clear();
+}
 
+inline Object& Object::operator = (const Object& object)
+{
+   if (&object != this)
+   {
+      // the members are copied in afresh (into our own arena, if any). the copy is 
+      //  made first, in case the other object lives in one of ours
+      Members members(object.m_Members.begin(), object.m_Members.end(), m_Members.get_allocator());
+      m_Members.swap(members);
+      m_Index.Clear();
+      if (m_Members.size() >= INDEX_THRESHOLD)
+         m_Index.Build(m_Members);
+      m_bExposed = false;
+   }
+   return *this;
+}
 
+inline Object& Object::operator = (Object&& object)
+{
+   if (&object != this)
+   {
+      // taken over first, in case it lives in one of our members. we keep our own 
+      //  arena (or the heap), & the members move over into it if need be
+      Object taken(std::move(object), GetArena());
+      Swap(taken);
+   }
+   return *this;
+}
+
+inline Arena* Object::GetArena() const { return m_Members.get_allocator().GetArena(); }
 
-inline Object::iterator Object::Begin() { return m_Members.begin(); }
-inline Object::iterator Object::End() { return m_Members.end(); }
+inline Object::iterator Object::Begin() { return Exposed(m_Members.begin()); }
+inline Object::iterator Object::End() { return Exposed(m_Members.end()); }
 inline Object::const_iterator Object::Begin() const { return m_Members.begin(); }
 inline Object::const_iterator Object::End() const { return m_Members.end(); }
 
 inline size_t Object::Size() const { return m_Members.size(); }
 inline bool Object::Empty() const { return m_Members.empty(); }
 
-inline Object::iterator Object::Find(const std::string& name) 
+inline Object::iterator Object::Find(const std::string& name)                   { return Find(name.data(), name.size()); }
+inline Object::const_iterator Object::Find(const std::string& name) const       { return Find(name.data(), name.size()); }
+inline Object::iterator Object::Find(const char* name)                          { return Find(name, std::strlen(name)); }
+inline Object::const_iterator Object::Find(const char* name) const              { return Find(name, std::strlen(name)); }
+
+inline Object::iterator Object::Find(const Name& name)
 {
-   return std::find_if(m_Members.begin(), m_Members.end(), Finder(name));
+   size_t nPosition = Position(name);
+   return Exposed((nPosition == Index::NOT_FOUND) ? m_Members.end() : m_Members.begin() + nPosition);
 }
 
-inline Object::const_iterator Object::Find(const std::string& name) const 
+inline Object::const_iterator Object::Find(const Name& name) const
 {
-   return std::find_if(m_Members.begin(), m_Members.end(), Finder(name));
+   size_t nPosition = Position(name);
+   return (nPosition == Index::NOT_FOUND) ? m_Members.end() : m_Members.begin() + nPosition;
+}
+
+inline Object::iterator Object::Find(const char* name, size_t nLength)
+{
+   size_t nPosition = Position(name, nLength);
+   return Exposed((nPosition == Index::NOT_FOUND) ? m_Members.end() : m_Members.begin() + nPosition);
+}
+
+inline Object::const_iterator Object::Find(const char* name, size_t nLength) const
+{
+   size_t nPosition = Position(name, nLength);
+   return (nPosition == Index::NOT_FOUND) ? m_Members.end() : m_Members.begin() + nPosition;
+}
+
+inline size_t Object::Position(const Name& name) const
+{
+   // whatever the index finds is right (names are checked), but it could be missing
+   //  a member renamed or moved through an iterator since it was built
+   if (m_Index.Built())
+   {
+      size_t nPosition = m_Index.Find(m_Members, name);
+      if (nPosition != Index::NOT_FOUND || m_bExposed == false)
+         return nPosition;
+   }
+
+   for (size_t nPosition = 0; nPosition < m_Members.size(); ++nPosition)
+   {
+      if (m_Members[nPosition].name == name)
+         return nPosition;
+   }
+   return Index::NOT_FOUND;
+}
+
+inline size_t Object::Position(const char* name, size_t nLength) const
+{
+   // same again
+   if (m_Index.Built())
+   {
+      size_t nPosition = m_Index.Find(m_Members, name, nLength, Name::Hash(name, nLength));
+      if (nPosition != Index::NOT_FOUND || m_bExposed == false)
+         return nPosition;
+   }
+
+   for (size_t nPosition = 0; nPosition < m_Members.size(); ++nPosition)
+   {
+      const Name& nameMember = m_Members[nPosition].name;
+      if (nameMember.size() == nLength &&
+          std::memcmp(nameMember.data(), name, nLength) == 0)
+         return nPosition;
+   }
+   return Index::NOT_FOUND;
+}
+
+inline Object::iterator Object::Exposed(iterator it)
+{
+   m_bExposed = true;
+   return it;
 }
 
 inline Object::iterator Object::Insert(const Member& member)
@@ -290,29 +700,65 @@ inline Object::iterator Object::Insert(const Member& member)
 
 inline Object::iterator Object::Insert(const Member& member, iterator itWhere)
 {
-   iterator it = Find(member.name);
-   if (it != m_Members.end())
-      throw Exception(std::string("Object member already exists: ") + member.name);
+   if (Position(member.name) != Index::NOT_FOUND)
+      throw Exception(std::string("Object member already exists: ") + member.name.Value());
 
-   it = m_Members.insert(itWhere, member);
-   return it;
+   size_t nPosition = itWhere - m_Members.begin();
+   EmplaceBack(member);
+   return Exposed(Indexed(MoveBack(m_Members.begin() + nPosition)));
+}
+
+inline Object::iterator Object::Insert(Member&& member)
+{
+   return Insert(std::move(member), End());
+}
+
+inline Object::iterator Object::Insert(Member&& member, iterator itWhere)
+{
+   if (Position(member.name) != Index::NOT_FOUND)
+      throw Exception(std::string("Object member already exists: ") + member.name.Value());
+
+   size_t nPosition = itWhere - m_Members.begin();
+   EmplaceBack(std::move(member));
+   return Exposed(Indexed(MoveBack(m_Members.begin() + nPosition)));
+}
+
+template <typename ElementTypeT>
+Object::iterator Object::Emplace(const Name& name, ElementTypeT&& element)
+{
+   return Emplace(name, std::forward<ElementTypeT>(element), End());
+}
+
+template <typename ElementTypeT>
+Object::iterator Object::Emplace(const Name& name, ElementTypeT&& element, iterator itWhere)
+{
+   if (Position(name) != Index::NOT_FOUND)
+      throw Exception(std::string("Object member already exists: ") + name.Value());
+
+   size_t nPosition = itWhere - m_Members.begin();
+   EmplaceBack(Name(name), UnknownElement(std::forward<ElementTypeT>(element)));
+   return Exposed(Indexed(MoveBack(m_Members.begin() + nPosition)));
 }
 
 inline Object::iterator Object::Erase(iterator itWhere) 
 {
-   return m_Members.erase(itWhere);
+   size_t nPosition = itWhere - m_Members.begin();
+   if (m_Index.Built())
+      m_Index.Erase(nPosition, itWhere->name.Hash());
+
+   // swapped down to the end & dropped there (see MoveBack)
+   for (iterator it = itWhere + 1; it != m_Members.end(); ++it)
+      Exchange(*(it - 1), *it);
+   m_Members.pop_back();
+   return Exposed(m_Members.begin() + nPosition);
 }
 
 inline UnknownElement& Object::operator [](const std::string& name)
 {
-
-   iterator it = Find(name);
-   if (it == m_Members.end())
-   {
-      Member member(name);
-      it = Insert(member, End());
-   }
-   return it->element;      
+   size_t nPosition = Position(name.data(), name.size());
+   if (nPosition == Index::NOT_FOUND)
+      return Append(Member(Name(name)))->element;
+   return m_Members[nPosition].element;
 }
 
 inline const UnknownElement& Object::operator [](const std::string& name) const 
@@ -323,9 +769,43 @@ inline const UnknownElement& Object::operator [](const std::string& name) const
    return it->element;
 }
 
+inline UnknownElement& Object::operator [](const char* name)
+{
+   size_t nPosition = Position(name, std::strlen(name));
+   if (nPosition == Index::NOT_FOUND)
+      return Append(Member(Name(name)))->element;
+   return m_Members[nPosition].element;
+}
+
+inline const UnknownElement& Object::operator [](const char* name) const 
+{
+   const_iterator it = Find(name);
+   if (it == End())
+      throw Exception(std::string("Object member not found: ") + name);
+   return it->element;
+}
+
 inline void Object::Clear() 
 {
    m_Members.clear(); 
+   m_Index.Clear();
+   m_bExposed = false;
+}
+
+inline void Object::Swap(Object& object)
+{
+   // objects in different arenas keep their own storage, & trade members instead
+   if (GetArena() != object.GetArena())
+   {
+      Object temp(std::move(object), object.GetArena());
+      object = std::move(*this);
+      *this = std::move(temp);
+      return;
+   }
+
+   m_Members.swap(object.m_Members);
+   m_Index.Swap(object.m_Index);
+   std::swap(m_bExposed, object.m_bExposed);
 }
 
 inline bool Object::operator == (const Object& object) const 
@@ -333,18 +813,324 @@ inline bool Object::operator == (const Object& object) const
    return m_Members == object.m_Members;
 }
 
+inline Object::iterator Object::Indexed(iterator itMember)
+{
+   // keeps the index up to date with a newly inserted member, building it once
+   //  we're big enough
+   if (m_Index.Built())
+      m_Index.Insert(itMember - m_Members.begin(), itMember->name.Hash());
+   else if (m_Members.size() >= INDEX_THRESHOLD)
+      m_Index.Build(m_Members);
+   return itMember;
+}
+
+inline Object::iterator Object::Append(Member&& member)
+{
+   EmplaceBack(std::move(member));
+
+   // adding a member invalidates any iterators handed out, so whatever they did to
+   //  the members is done with: rebuild the index from them, & it's good again
+   if (m_bExposed)
+   {
+      m_bExposed = false;
+      if (m_Index.Built())
+      {
+         m_Index.Build(m_Members);
+         return m_Members.end() - 1;
+      }
+   }
+   return Indexed(m_Members.end() - 1);
+}
+
+inline Object::iterator Object::MoveBack(iterator itWhere)
+{
+   for (iterator it = m_Members.end() - 1; it != itWhere; --it)
+      Exchange(*(it - 1), *it);
+   return itWhere;
+}
+
+inline void Object::Exchange(Member& a, Member& b)
+{
+   // like swap(a, b), but without moving arena boxes out of their arena
+   a.name.Swap(b.name);
+   a.element.Exchange(b.element);
+}
+
+inline void Object::Forget()
+{
+   // the members themselves are left for the arena
+   for (iterator it = m_Members.begin(); it != m_Members.end(); ++it)
+   {
+      it->name.~Name();
+      it->element.Forget();
+   }
+   if (m_Index.Built())
+      Index().Swap(m_Index);
+}
+
+template <typename... ArgumentTypesT>
+void Object::EmplaceBack(ArgumentTypesT&&... arguments)
+{
+   if (m_Members.size() < m_Members.capacity())
+   {
+      m_Members.emplace_back(std::forward<ArgumentTypesT>(arguments)...);
+      return;
+   }
+
+   // same as Array's
+   Members members(m_Members.get_allocator());
+   members.reserve(std::max<size_t>(m_Members.capacity() * 2, 4));
+   members.emplace_back(std::forward<ArgumentTypesT>(arguments)...);
+   for (iterator it = m_Members.begin(); it != m_Members.end(); ++it)
+   {
+      members.push_back(std::move(*it));
+      Exchange(*(members.end() - 2), members.back());
+   }
+   m_Members.swap(members);
+}
+
+
+/////////////////////////
+// Object::Index members
+
+inline Object::Index::Index() :
+   m_nSize(0) {}
+
+inline void Object::Index::Build(const Members& members)
+{
+   // room to spare, so probe sequences stay short
+   size_t nSlots = 32;
+   while (nSlots < members.size() * 2)
+      nSlots *= 2;
+
+   Slot slotEmpty = { 0, NOT_FOUND };
+   m_Slots.assign(nSlots, slotEmpty);
+   m_nSize = 0;
+
+   for (size_t n = 0; n < members.size(); ++n)
+      Add(n, members[n].name.Hash());
+}
+
+inline void Object::Index::Clear()
+{
+   m_Slots.clear();
+   m_nSize = 0;
+}
+
+inline void Object::Index::Swap(Index& index)
+{
+   m_Slots.swap(index.m_Slots);
+   std::swap(m_nSize, index.m_nSize);
+}
+
+inline bool Object::Index::Built() const
+{
+   return m_Slots.empty() == false;
+}
+
+inline size_t Object::Index::Find(const Members& members, const char* name, size_t nLength, size_t nHash) const
+{
+   size_t nMask = m_Slots.size() - 1;
+   for (size_t n = nHash & nMask; m_Slots[n].nPosition != NOT_FOUND; n = (n + 1) & nMask)
+   {
+      const Slot& slot = m_Slots[n];
+      if (slot.nHash != nHash)
+         continue;
+
+      const Name& nameMember = members[slot.nPosition].name;
+      if (nameMember.size() == nLength &&
+          std::memcmp(nameMember.data(), name, nLength) == 0)
+         return slot.nPosition;
+   }
+   return NOT_FOUND;
+}
+
+inline size_t Object::Index::Find(const Members& members, const Name& name) const
+{
+   size_t nHash = name.Hash();
+   size_t nMask = m_Slots.size() - 1;
+   for (size_t n = nHash & nMask; m_Slots[n].nPosition != NOT_FOUND; n = (n + 1) & nMask)
+   {
+      const Slot& slot = m_Slots[n];
+      if (slot.nHash == nHash && members[slot.nPosition].name == name)
+         return slot.nPosition;
+   }
+   return NOT_FOUND;
+}
+
+inline void Object::Index::Insert(size_t nPosition, size_t nHash)
+{
+   // anything at or after the insertion point just moved up one
+   if (nPosition < m_nSize)
+   {
+      for (size_t n = 0; n < m_Slots.size(); ++n)
+      {
+         if (m_Slots[n].nPosition != NOT_FOUND && m_Slots[n].nPosition >= nPosition)
+            ++m_Slots[n].nPosition;
+      }
+   }
+
+   Add(nPosition, nHash);
+}
+
+inline void Object::Index::Erase(size_t nPosition, size_t nHash)
+{
+   size_t nMask = m_Slots.size() - 1;
+   size_t n = nHash & nMask;
+   while (m_Slots[n].nPosition != nPosition)
+      n = (n + 1) & nMask;
+
+   // close the gap by shifting back any later entries that probed past it, so
+   //  no lookup ever stops short
+   size_t nNext = n;
+   while (true)
+   {
+      nNext = (nNext + 1) & nMask;
+      if (m_Slots[nNext].nPosition == NOT_FOUND)
+         break;
+
+      size_t nHome = m_Slots[nNext].nHash & nMask;
+      bool bMovable = (n <= nNext) ? (nHome <= n || nHome > nNext)
+                                   : (nHome <= n && nHome > nNext);
+      if (bMovable)
+      {
+         m_Slots[n] = m_Slots[nNext];
+         n = nNext;
+      }
+   }
+
+   m_Slots[n].nPosition = NOT_FOUND;
+   --m_nSize;
+
+   // ...and everything after the erased member moved down one
+   if (nPosition < m_nSize)
+   {
+      for (size_t n = 0; n < m_Slots.size(); ++n)
+      {
+         if (m_Slots[n].nPosition != NOT_FOUND && m_Slots[n].nPosition > nPosition)
+            --m_Slots[n].nPosition;
+      }
+   }
+}
+
+inline void Object::Index::Add(size_t nPosition, size_t nHash)
+{
+   if ((m_nSize + 1) * 2 > m_Slots.size())
+      Grow();
+
+   size_t nMask = m_Slots.size() - 1;
+   size_t n = nHash & nMask;
+   while (m_Slots[n].nPosition != NOT_FOUND)
+      n = (n + 1) & nMask;
+
+   m_Slots[n].nHash = nHash;
+   m_Slots[n].nPosition = nPosition;
+   ++m_nSize;
+}
+
+inline void Object::Index::Grow()
+{
+   Slot slotEmpty = { 0, NOT_FOUND };
+   std::vector<Slot> slots(m_Slots.size() * 2, slotEmpty);
+   slots.swap(m_Slots);
+   m_nSize = 0;
+
+   for (size_t n = 0; n < slots.size(); ++n)
+   {
+      if (slots[n].nPosition != NOT_FOUND)
+         Add(slots[n].nPosition, slots[n].nHash);
+   }
+}
+
 
 /////////////////
 // Array members
 
-inline Array::iterator Array::Begin()  { return m_Elements.begin(); }
-inline Array::iterator Array::End()    { return m_Elements.end(); }
-inline Array::const_iterator Array::Begin() const  { return m_Elements.begin(); }
-inline Array::const_iterator Array::End() const    { return m_Elements.end(); }
+inline Array::Array() : m_nState(ELEMENTS) {}
+
+inline Array::Array(Arena& arena) : 
+   m_Elements(ArenaAllocator<UnknownElement>(&arena)),
+   m_Numbers(ArenaAllocator<double>(&arena)),
+   m_nState(ELEMENTS) {}
+
+inline Array::Array(const Array& array) : m_nState(ELEMENTS)
+{
+   CopyFrom(array);
+}
+
+inline Array::Array(Array&& array) : Array(std::move(array), 0) {}
+
+inline Array::Array(Array&& array, Arena* pArena) :
+   m_Elements(ArenaAllocator<UnknownElement>(pArena)),
+   m_Numbers(ArenaAllocator<double>(pArena)),
+   m_nState(array.m_nState.load(std::memory_order_relaxed))
+{
+   if (array.GetArena() == pArena)
+   {
+      m_Elements.swap(array.m_Elements);
+      m_Numbers.swap(array.m_Numbers);
+   }
+   else
+   {
+      // moving the elements over copies any arena boxes out of their arena
+      m_Elements.reserve(array.m_Elements.size());
+      for (iterator it = array.m_Elements.begin(); it != array.m_Elements.end(); ++it)
+         m_Elements.push_back(std::move(*it));
+      m_Numbers.assign(array.m_Numbers.begin(), array.m_Numbers.end());
+      array.m_Elements.clear();
+      array.m_Numbers.clear();
+   }
+   array.m_nState.store(ELEMENTS, std::memory_order_relaxed);
+}
+
+inline Array& Array::operator = (const Array& array)
+{
+   if (this != &array)
+      CopyFrom(array);
+   return *this;
+}
+
+inline Array& Array::operator = (Array&& array)
+{
+   if (this != &array)
+   {
+      // taken over first, in case it lives in one of our elements. we keep our own
+      //  arena (or the heap), & the elements move over into it if need be
+      Array taken(std::move(array), GetArena());
+      Swap(taken);
+   }
+   return *this;
+}
+
+inline void Array::CopyFrom(const Array& array)
+{
+   // a packed source only needs its numbers copied, cache or not
+   if (array.m_nState.load(std::memory_order_acquire) != ELEMENTS)
+   {
+      m_Numbers = array.m_Numbers;
+      m_Elements.clear();
+      m_nState.store(PACKED, std::memory_order_relaxed);
+   }
+   else
+   {
+      m_Elements = array.m_Elements;
+      m_Numbers.clear();
+      m_nState.store(ELEMENTS, std::memory_order_relaxed);
+   }
+}
+
+inline Arena* Array::GetArena() const { return m_Elements.get_allocator().GetArena(); }
+
+inline Array::iterator Array::Begin()  { Unpack(); return m_Elements.begin(); }
+inline Array::iterator Array::End()    { Unpack(); return m_Elements.end(); }
+inline Array::const_iterator Array::Begin() const  { UnpackCache(); return m_Elements.begin(); }
+inline Array::const_iterator Array::End() const    { UnpackCache(); return m_Elements.end(); }
 
 inline Array::iterator Array::Insert(const UnknownElement& element, iterator itWhere)
 { 
-   return m_Elements.insert(itWhere, element);
+   size_t nPosition = itWhere - m_Elements.begin();
+   EmplaceBack(element);
+   return MoveBack(m_Elements.begin() + nPosition);
 }
 
 inline Array::iterator Array::Insert(const UnknownElement& element)
@@ -352,43 +1138,280 @@ inline Array::iterator Array::Insert(const UnknownElement& element)
    return Insert(element, End());
 }
 
+inline Array::iterator Array::Insert(UnknownElement&& element, iterator itWhere)
+{ 
+   size_t nPosition = itWhere - m_Elements.begin();
+   EmplaceBack(std::move(element));
+   return MoveBack(m_Elements.begin() + nPosition);
+}
+
+inline Array::iterator Array::Insert(UnknownElement&& element)
+{
+   return Insert(std::move(element), End());
+}
+
+template <typename ElementTypeT>
+Array::iterator Array::Emplace(ElementTypeT&& element, iterator itWhere)
+{
+   size_t nPosition = itWhere - m_Elements.begin();
+   EmplaceBack(std::forward<ElementTypeT>(element));
+   return MoveBack(m_Elements.begin() + nPosition);
+}
+
+template <typename ElementTypeT>
+Array::iterator Array::Emplace(ElementTypeT&& element)
+{
+   return Emplace(std::forward<ElementTypeT>(element), End());
+}
+
 inline Array::iterator Array::Erase(iterator itWhere)
 { 
-   return m_Elements.erase(itWhere);
+   // swapped down to the end & dropped there (see MoveBack)
+   size_t nPosition = itWhere - m_Elements.begin();
+   for (iterator it = itWhere + 1; it != m_Elements.end(); ++it)
+      (it - 1)->Exchange(*it);
+   m_Elements.pop_back();
+   return m_Elements.begin() + nPosition;
+}
+
+inline Array::iterator Array::MoveBack(iterator itWhere)
+{
+   // element moves would copy arena boxes out of the arena, so the elements in the 
+   //  way are swapped up outright instead
+   for (iterator it = m_Elements.end() - 1; it != itWhere; --it)
+      (it - 1)->Exchange(*it);
+   return itWhere;
+}
+
+template <typename... ArgumentTypesT>
+void Array::EmplaceBack(ArgumentTypesT&&... arguments)
+{
+   if (m_Elements.size() < m_Elements.capacity())
+   {
+      m_Elements.emplace_back(std::forward<ArgumentTypesT>(arguments)...);
+      return;
+   }
+
+   // the arguments could be (or be in) one of our elements, so the new element is
+   //  made first, & swapped up past the others as they're moved in after it
+   Elements elements(m_Elements.get_allocator());
+   elements.reserve(std::max<size_t>(m_Elements.capacity() * 2, 4));
+   elements.emplace_back(std::forward<ArgumentTypesT>(arguments)...);
+   for (iterator it = m_Elements.begin(); it != m_Elements.end(); ++it)
+   {
+      elements.push_back(std::move(*it));
+      (elements.end() - 2)->Exchange(elements.back());
+   }
+   m_Elements.swap(elements);
+}
+
+inline void Array::Grow(size_t nSize)
+{
+   if (nSize > m_Elements.capacity())
+      Reallocate(std::max(nSize, m_Elements.capacity() * 2));
+}
+
+inline void Array::Reallocate(size_t nCapacity)
+{
+   // the elements stay in our arena, so moving them never copies
+   Elements elements(m_Elements.get_allocator());
+   elements.reserve(nCapacity);
+   for (iterator it = m_Elements.begin(); it != m_Elements.end(); ++it)
+      elements.push_back(std::move(*it));
+   m_Elements.swap(elements);
 }
 
 inline void Array::Resize(size_t newSize)
 {
+   Unpack();
+   Grow(newSize);
    m_Elements.resize(newSize);
 }
 
-inline size_t Array::Size() const  { return m_Elements.size(); }
-inline bool Array::Empty() const   { return m_Elements.empty(); }
+inline void Array::Reserve(size_t nCapacity)
+{
+   if (m_nState.load(std::memory_order_relaxed) != ELEMENTS)
+      m_Numbers.reserve(nCapacity);
+   else if (nCapacity > m_Elements.capacity())
+      Reallocate(nCapacity);
+}
+
+inline size_t Array::Size() const  
+{ 
+   return m_nState.load(std::memory_order_acquire) == ELEMENTS ? m_Elements.size() : m_Numbers.size(); 
+}
+
+inline bool Array::Empty() const   { return Size() == 0; }
 
 inline UnknownElement& Array::operator[] (size_t index)
 {
+   Unpack();
    size_t nMinSize = index + 1; // zero indexed
    if (m_Elements.size() < nMinSize)
+   {
+      Grow(nMinSize);
       m_Elements.resize(nMinSize);
+   }
    return m_Elements[index]; 
 }
 
 inline const UnknownElement& Array::operator[] (size_t index) const 
 {
-   if (index >= m_Elements.size())
+   if (index >= Size())
       throw Exception("Array out of bounds");
+   UnpackCache();
    return m_Elements[index]; 
 }
 
 inline void Array::Clear() {
    m_Elements.clear();
+   m_Numbers.clear();
+   m_nState.store(ELEMENTS, std::memory_order_relaxed);
+}
+
+inline void Array::Swap(Array& array)
+{
+   // arrays in different arenas keep their own storage, & trade elements instead
+   if (GetArena() != array.GetArena())
+   {
+      Array temp(std::move(array), array.GetArena());
+      array = std::move(*this);
+      *this = std::move(temp);
+      return;
+   }
+
+   m_Elements.swap(array.m_Elements);
+   m_Numbers.swap(array.m_Numbers);
+   int nState = m_nState.load(std::memory_order_relaxed);
+   m_nState.store(array.m_nState.load(std::memory_order_relaxed), std::memory_order_relaxed);
+   array.m_nState.store(nState, std::memory_order_relaxed);
 }
 
 inline bool Array::operator == (const Array& array) const
 {
+   const double* pNumbers = Numbers();
+   const double* pOther = array.Numbers();
+   if (pNumbers && pOther)
+      return m_Numbers == array.m_Numbers;
+
+   // a packed array & an unpacked one might still match
+   UnpackCache();
+   array.UnpackCache();
    return m_Elements == array.m_Elements;
 }
 
+inline bool Array::Pack()
+{
+   int nState = m_nState.load(std::memory_order_relaxed);
+   if (nState == ELEMENTS)
+   {
+      Elements::const_iterator it(m_Elements.begin()), itEnd(m_Elements.end());
+      for (; it != itEnd; ++it)
+         if (it->IsNumber() == false)
+            return false;
+
+      m_Numbers.reserve(m_Elements.size());
+      for (it = m_Elements.begin(); it != itEnd; ++it)
+         m_Numbers.push_back(static_cast<const Number&>(*it).Value());
+   }
+
+   // anything in m_Elements is about to go stale
+   Elements(m_Elements.get_allocator()).swap(m_Elements);
+   m_nState.store(PACKED, std::memory_order_relaxed);
+   return true;
+}
+
+inline bool Array::IsPacked() const
+{
+   return m_nState.load(std::memory_order_acquire) != ELEMENTS;
+}
+
+inline double* Array::Numbers()
+{
+   if (m_nState.load(std::memory_order_relaxed) == ELEMENTS)
+      return 0;
+
+   // the caller may write through this, so drop any cached copy
+   Elements(m_Elements.get_allocator()).swap(m_Elements);
+   m_nState.store(PACKED, std::memory_order_relaxed);
+   return m_Numbers.empty() ? NoNumbers() : m_Numbers.data();
+}
+
+inline const double* Array::Numbers() const
+{
+   if (IsPacked() == false)
+      return 0;
+   return m_Numbers.empty() ? NoNumbers() : m_Numbers.data();
+}
+
+inline double* Array::NoNumbers()
+{
+   static double dNone = 0;
+   return &dNone;
+}
+
+inline void Array::Forget()
+{
+   // numbers (packed or not) need nothing doing, & neither does the storage
+   if (m_nState.load(std::memory_order_relaxed) != ELEMENTS)
+      return;
+
+   for (iterator it = m_Elements.begin(); it != m_Elements.end(); ++it)
+      it->Forget();
+}
+
+inline void Array::Unpack()
+{
+   int nState = m_nState.load(std::memory_order_relaxed);
+   if (nState == ELEMENTS)
+      return;
+
+   if (nState == PACKED)
+   {
+      m_Elements.reserve(m_Numbers.size());
+      Doubles::const_iterator it(m_Numbers.begin()), itEnd(m_Numbers.end());
+      for (; it != itEnd; ++it)
+         m_Elements.emplace_back(Number(*it));
+   }
+
+   Doubles(m_Numbers.get_allocator()).swap(m_Numbers);
+   m_nState.store(ELEMENTS, std::memory_order_relaxed);
+}
+
+inline void Array::UnpackCache() const
+{
+   // whichever reader moves the array from PACKED to PACKED_FILLING fills the cache,
+   //  while any others wait for it. other arrays aren't held up at all
+   int nState = m_nState.load(std::memory_order_acquire);
+   while (nState == PACKED || nState == PACKED_FILLING)
+   {
+      if (nState == PACKED_FILLING)
+      {
+         std::this_thread::yield();
+         nState = m_nState.load(std::memory_order_acquire);
+      }
+      else if (m_nState.compare_exchange_strong(nState, PACKED_FILLING, std::memory_order_acquire))
+      {
+         try
+         {
+            m_Elements.reserve(m_Numbers.size());
+            Doubles::const_iterator it(m_Numbers.begin()), itEnd(m_Numbers.end());
+            for (; it != itEnd; ++it)
+               m_Elements.emplace_back(Number(*it));
+         }
+         catch (...)
+         {
+            // leave it for the next reader to try
+            m_Elements.clear();
+            m_nState.store(PACKED, std::memory_order_release);
+            throw;
+         }
+         m_nState.store(PACKED_CACHED, std::memory_order_release);
+         return;
+      }
+   }
+}
+
 
 ////////////////////////
 // TrivialType_T members
@@ -397,6 +1420,10 @@ template <typename DataTypeT>
 TrivialType_T<DataTypeT>::TrivialType_T(const DataTypeT& t) :
    m_tValue(t) {}
 
+template <typename DataTypeT>
+TrivialType_T<DataTypeT>::TrivialType_T(DataTypeT&& t) :
+   m_tValue(std::move(t)) {}
+
 template <typename DataTypeT>
 TrivialType_T<DataTypeT>::operator DataTypeT&()
 {
@@ -427,6 +1454,13 @@ bool TrivialType_T<DataTypeT>::operator == (const TrivialType_T<DataTypeT>& triv
    return m_tValue == trivial.m_tValue;
 }
 
+template <typename DataTypeT>
+void TrivialType_T<DataTypeT>::Swap(TrivialType_T<DataTypeT>& trivial)
+{
+   using std::swap;
+   swap(m_tValue, trivial.m_tValue);
+}
+
 
 
 //////////////////
@@ -439,4 +1473,16 @@ inline bool Null::operator == (const Null& trivial) const
 
 
 
+//////////////////
+// swap overloads
+
+inline void swap(UnknownElement& a, UnknownElement& b)            { a.Swap(b); }
+inline void swap(Array& a, Array& b)                              { a.Swap(b); }
+inline void swap(Object& a, Object& b)                            { a.Swap(b); }
+
+template <typename DataTypeT>
+void swap(TrivialType_T<DataTypeT>& a, TrivialType_T<DataTypeT>& b)   { a.Swap(b); }
+
+
+
 } // End namespace
@@ -0,0 +1,144 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include "elements.h"
+#include "reader.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace json
+{
+
+class LazyDocument;
+
+
+/////////////////////////////////////////////////////////////////////////
+// LazyElement - a view of one value inside a LazyDocument. Navigating with 
+//  operator [] only consults the document's structural index; nothing is 
+//  parsed until the view is cast to an element type, at which point just that
+//  value (and its children) is read. Like UnknownElement, a mismatched cast or
+//  missing child throws.
+//
+//  LazyDocument document(pData, nLength);
+//  String strCompany = document["Invoices"][1]["Customer"]["Company"];
+
+class LazyElement
+{
+public:
+   // provides quick access to children when the value is an object...
+   LazyElement operator[] (const std::string& key) const;
+
+   // ...or an array
+   LazyElement operator[] (size_t index) const;
+
+   // number of members/elements when the value is an object/array
+   size_t Size() const;
+
+   // materializes the value. throws on a type mismatch
+   operator Object () const;
+   operator Array () const;
+   operator Number () const;
+   operator Boolean () const;
+   operator String () const;
+   operator Null () const;
+
+   UnknownElement Materialize() const;
+
+private:
+   friend class LazyDocument;
+
+   LazyElement(const LazyDocument& document, size_t nBegin, size_t nEnd, size_t nEntry);
+
+   char FirstChar() const;
+   void CheckType(char cExpected) const;
+   bool IsEmpty(size_t nClose) const;
+   size_t ScanChild(size_t nDelimiter, size_t nClose, size_t* pNameBegin, size_t* pNameEnd,
+                    size_t& nValueBegin, size_t& nValueEnd) const;
+   bool NameEquals(size_t nNameBegin, size_t nNameEnd, const std::string& key) const;
+   void ThrowMalformed() const;
+
+   template <typename ElementTypeT>
+   void Read(ElementTypeT& element) const;
+
+   const LazyDocument* m_pDocument;
+   size_t m_nBegin;        // value's text, white space trimmed
+   size_t m_nEnd;
+   size_t m_nEntry;        // first structural index entry at or after m_nBegin
+};
+
+
+/////////////////////////////////////////////////////////////////////////
+// LazyDocument - indexes a document held in memory in one quick pass (the 
+//  position of every bracket, colon & comma outside of strings, and where 
+//  each bracket's partner is), so that values can be found & read on demand.
+//  Ideal when only a few values are needed out of a large document. The
+//  buffer is not copied, and must outlive the LazyDocument & its views.
+//  Bracket mismatches are caught up front; anything else as values are read.
+
+class LazyDocument
+{
+public:
+   LazyDocument(const char* pData, size_t nLength);
+
+   LazyElement Root() const;
+
+   // shortcuts to Root()[...]
+   LazyElement operator[] (const std::string& key) const;
+   LazyElement operator[] (size_t index) const;
+
+private:
+   friend class LazyElement;
+
+   struct Entry
+   {
+      unsigned int nOffset;   // position of the structural character
+      unsigned int nMatch;    // for opening brackets, index of the closing partner
+   };
+
+   typedef std::vector<Entry> Entries;
+
+   void BuildIndex();
+   size_t TrimBegin(size_t nBegin, size_t nEnd) const;
+   size_t TrimEnd(size_t nBegin, size_t nEnd) const;
+   Reader::Location LocationOf(size_t nOffset) const;
+   Reader::Location Relocate(const Reader::Location& location, size_t nBase) const;
+
+   const char* m_pData;
+   size_t m_nLength;
+   Entries m_Entries;
+};
+
+
+} // End namespace
+
+
+#include "lazy.inl"
@@ -0,0 +1,429 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+namespace json
+{
+
+
+//////////////////
+// LazyElement
+
+inline LazyElement::LazyElement(const LazyDocument& document, size_t nBegin, size_t nEnd, size_t nEntry) :
+   m_pDocument(&document),
+   m_nBegin(nBegin),
+   m_nEnd(nEnd),
+   m_nEntry(nEntry)
+{}
+
+
+inline LazyElement LazyElement::operator[] (const std::string& key) const
+{
+   CheckType('{');
+
+   size_t nClose = m_pDocument->m_Entries[m_nEntry].nMatch;
+   size_t nDelimiter = m_nEntry;
+   if (IsEmpty(nClose) == false)
+   {
+      while (true)
+      {
+         size_t nNameBegin, nNameEnd, nValueBegin, nValueEnd;
+         size_t nNext = ScanChild(nDelimiter, nClose, &nNameBegin, &nNameEnd, nValueBegin, nValueEnd);
+         if (NameEquals(nNameBegin, nNameEnd, key))
+            return LazyElement(*m_pDocument, nValueBegin, nValueEnd, nDelimiter + 2);
+
+         if (nNext == nClose)
+            break;
+         nDelimiter = nNext;
+      }
+   }
+
+   throw Exception(std::string("Object member not found: ") + key);
+}
+
+
+inline LazyElement LazyElement::operator[] (size_t index) const
+{
+   CheckType('[');
+
+   size_t nClose = m_pDocument->m_Entries[m_nEntry].nMatch;
+   size_t nDelimiter = m_nEntry;
+   if (IsEmpty(nClose) == false)
+   {
+      for (size_t nIndex = 0; ; ++nIndex)
+      {
+         size_t nValueBegin, nValueEnd;
+         size_t nNext = ScanChild(nDelimiter, nClose, 0, 0, nValueBegin, nValueEnd);
+         if (nIndex == index)
+            return LazyElement(*m_pDocument, nValueBegin, nValueEnd, nDelimiter + 1);
+
+         if (nNext == nClose)
+            break;
+         nDelimiter = nNext;
+      }
+   }
+
+   throw Exception("Array out of bounds");
+}
+
+
+inline size_t LazyElement::Size() const
+{
+   char c = FirstChar();
+   if (c != '{' && c != '[')
+      throw Exception("Bad cast");
+
+   size_t nClose = m_pDocument->m_Entries[m_nEntry].nMatch;
+   if (IsEmpty(nClose))
+      return 0;
+
+   size_t nNameBegin, nNameEnd, nValueBegin, nValueEnd;
+   size_t nDelimiter = m_nEntry;
+   size_t nSize = 1;
+   while ((nDelimiter = ScanChild(nDelimiter, nClose, (c == '{' ? &nNameBegin : 0), &nNameEnd, nValueBegin, nValueEnd)) != nClose)
+      ++nSize;
+   return nSize;
+}
+
+
+inline LazyElement::operator Object () const    { CheckType('{'); Object object; Read(object); return object; }
+inline LazyElement::operator Array () const     { CheckType('['); Array array; Read(array); return array; }
+inline LazyElement::operator String () const    { CheckType('"'); String string; Read(string); return string; }
+inline LazyElement::operator Null () const      { CheckType('n'); Null null; Read(null); return null; }
+
+inline LazyElement::operator Boolean () const
+{
+   char c = FirstChar();
+   if (c != 't' && c != 'f')
+      throw Exception("Bad cast");
+
+   Boolean boolean;
+   Read(boolean);
+   return boolean;
+}
+
+inline LazyElement::operator Number () const
+{
+   char c = FirstChar();
+   if (c != '-' && (c < '0' || c > '9'))
+      throw Exception("Bad cast");
+
+   Number number;
+   Read(number);
+   return number;
+}
+
+inline UnknownElement LazyElement::Materialize() const
+{
+   UnknownElement element;
+   Read(element);
+   return element;
+}
+
+
+inline char LazyElement::FirstChar() const
+{
+   return m_pDocument->m_pData[m_nBegin];
+}
+
+inline void LazyElement::CheckType(char cExpected) const
+{
+   if (FirstChar() != cExpected)
+      throw Exception("Bad cast");
+}
+
+
+inline bool LazyElement::IsEmpty(size_t nClose) const
+{
+   // nothing but white space between the brackets?
+   const LazyDocument::Entries& entries = m_pDocument->m_Entries;
+   if (nClose != m_nEntry + 1)
+      return false;
+
+   size_t nCloseOffset = entries[nClose].nOffset;
+   if (m_pDocument->TrimBegin(entries[m_nEntry].nOffset + 1, nCloseOffset) == nCloseOffset)
+      return true;
+
+   ThrowMalformed(); // something is in there, but it can't be a value
+   return false;
+}
+
+
+inline size_t LazyElement::ScanChild(size_t nDelimiter, size_t nClose, size_t* pNameBegin, size_t* pNameEnd,
+                                     size_t& nValueBegin, size_t& nValueEnd) const
+{
+   // a child follows the delimiter (opening bracket or comma) at entry nDelimiter. objects 
+   //  have a name & colon first. returns the entry of the delimiter behind the child: a 
+   //  comma, or the closing bracket
+   const LazyDocument::Entries& entries = m_pDocument->m_Entries;
+   const char* pData = m_pDocument->m_pData;
+
+   size_t nValueEntry = nDelimiter + 1;
+   size_t nValueOffset = entries[nDelimiter].nOffset + 1;
+   if (pNameBegin)
+   {
+      size_t nColon = nDelimiter + 1;
+      if (nColon >= nClose || pData[entries[nColon].nOffset] != ':')
+         ThrowMalformed();
+
+      *pNameBegin = m_pDocument->TrimBegin(nValueOffset, entries[nColon].nOffset);
+      *pNameEnd = m_pDocument->TrimEnd(*pNameBegin, entries[nColon].nOffset);
+      if (*pNameEnd - *pNameBegin < 2 ||
+          pData[*pNameBegin] != '"' ||
+          pData[*pNameEnd - 1] != '"')
+         ThrowMalformed();
+
+      nValueEntry = nColon + 1;
+      nValueOffset = entries[nColon].nOffset + 1;
+   }
+
+   // if the value is itself a container, skip straight past its partner bracket
+   nValueBegin = m_pDocument->TrimBegin(nValueOffset, entries[nValueEntry].nOffset);
+   size_t nNext = nValueEntry;
+   char c = pData[nValueBegin];
+   if (c == '{' || c == '[')
+      nNext = entries[nValueEntry].nMatch + 1;
+   else if (nValueBegin == entries[nValueEntry].nOffset)
+      ThrowMalformed(); // no value at all
+
+   if (nNext > nClose ||
+       (nNext != nClose && pData[entries[nNext].nOffset] != ','))
+      ThrowMalformed();
+
+   nValueEnd = m_pDocument->TrimEnd(nValueBegin, entries[nNext].nOffset);
+   return nNext;
+}
+
+
+inline bool LazyElement::NameEquals(size_t nNameBegin, size_t nNameEnd, const std::string& key) const
+{
+   // compare raw bytes if there are no escapes to worry about
+   const char* pName = m_pDocument->m_pData + nNameBegin + 1;
+   size_t nLength = nNameEnd - nNameBegin - 2;
+   if (std::find(pName, pName + nLength, '\\') == pName + nLength)
+      return nLength == key.size() && 
+             std::equal(pName, pName + nLength, key.begin());
+
+   String name;
+   LazyElement(*m_pDocument, nNameBegin, nNameEnd, 0).Read(name);
+   return name.Value() == key;
+}
+
+
+inline void LazyElement::ThrowMalformed() const
+{
+   // reading the whole thing will produce a proper exception...
+   UnknownElement element;
+   Read(element);
+
+   // ...and this should be unreachable
+   throw Reader::ParseException("Malformed document", m_pDocument->LocationOf(m_nBegin), m_pDocument->LocationOf(m_nEnd));
+}
+
+
+template <typename ElementTypeT>
+void LazyElement::Read(ElementTypeT& element) const
+{
+   try
+   {
+      Reader::Read(element, m_pDocument->m_pData + m_nBegin, m_nEnd - m_nBegin);
+   }
+   catch (Reader::ScanException& e)
+   {
+      e.m_locError = m_pDocument->Relocate(e.m_locError, m_nBegin);
+      throw;
+   }
+   catch (Reader::ParseException& e)
+   {
+      e.m_locTokenBegin = m_pDocument->Relocate(e.m_locTokenBegin, m_nBegin);
+      e.m_locTokenEnd = m_pDocument->Relocate(e.m_locTokenEnd, m_nBegin);
+      throw;
+   }
+}
+
+
+
+//////////////////
+// LazyDocument
+
+inline LazyDocument::LazyDocument(const char* pData, size_t nLength) :
+   m_pData(pData),
+   m_nLength(nLength)
+{
+   BuildIndex();
+}
+
+inline LazyElement LazyDocument::Root() const
+{
+   size_t nBegin = TrimBegin(0, m_nLength);
+   return LazyElement(*this, nBegin, TrimEnd(nBegin, m_nLength), 0);
+}
+
+inline LazyElement LazyDocument::operator[] (const std::string& key) const    { return Root()[key]; }
+inline LazyElement LazyDocument::operator[] (size_t index) const              { return Root()[index]; }
+
+
+inline void LazyDocument::BuildIndex()
+{
+   if (m_nLength >= 0xFFFFFFFFu)
+      throw Exception("Document too large for LazyDocument");
+
+   std::vector<size_t> openEntries;
+   const char* pBegin = m_pData;
+   const char* pEnd = m_pData + m_nLength;
+   const char* p = pBegin;
+   while (p != pEnd)
+   {
+      char c = *p;
+      switch (c)
+      {
+         case '"':
+         {
+            // skip over strings entirely; brackets & such inside don't count
+            ++p;
+            while (true)
+            {
+               p = Scanner::FindStringSpecial(p, pEnd);
+               if (p == pEnd)
+                  throw Reader::ScanException("Expected string: \"", LocationOf(m_nLength));
+               if (*p == '"')
+                  break;
+               p += (*p == '\\' && p + 1 != pEnd) ? 2 : 1;
+            }
+            ++p;
+            continue;
+         }
+
+         case '{':
+         case '[':
+            openEntries.push_back(m_Entries.size());
+            break;
+
+         case '}':
+         case ']':
+         {
+            if (openEntries.empty() ||
+                m_pData[m_Entries[openEntries.back()].nOffset] != (c == '}' ? '{' : '['))
+            {
+               std::string sMessage = std::string("Unexpected token: ") + c;
+               throw Reader::ParseException(sMessage, LocationOf(p - pBegin), LocationOf(p - pBegin + 1));
+            }
+            m_Entries[openEntries.back()].nMatch = static_cast<unsigned int>(m_Entries.size());
+            openEntries.pop_back();
+            break;
+         }
+
+         case ':':
+         case ',':
+            break;
+
+         default:
+            ++p;
+            continue;
+      }
+
+      Entry entry;
+      entry.nOffset = static_cast<unsigned int>(p - pBegin);
+      entry.nMatch = 0;
+      m_Entries.push_back(entry);
+      ++p;
+   }
+
+   if (openEntries.empty() == false)
+      throw Reader::ParseException("Unexpected end of token stream", LocationOf(m_nLength), LocationOf(m_nLength));
+
+   size_t nBegin = TrimBegin(0, m_nLength);
+   if (nBegin == m_nLength)
+      throw Reader::ParseException("Unexpected end of token stream", LocationOf(m_nLength), LocationOf(m_nLength));
+
+   // everything indexed must belong to the root element
+   size_t nRootEntries = 0;
+   if (m_Entries.empty() == false && m_Entries[0].nOffset == nBegin)
+      nRootEntries = m_Entries[0].nMatch + 1;
+   if (nRootEntries < m_Entries.size())
+   {
+      size_t nOffset = m_Entries[nRootEntries].nOffset;
+      std::string sMessage = std::string("Expected End of token stream; found ") + m_pData[nOffset];
+      throw Reader::ParseException(sMessage, LocationOf(nOffset), LocationOf(nOffset + 1));
+   }
+
+   // add a sentinel, so a scalar root's "next delimiter" is the end of the document
+   Entry entry;
+   entry.nOffset = static_cast<unsigned int>(m_nLength);
+   entry.nMatch = 0;
+   m_Entries.push_back(entry);
+}
+
+
+inline size_t LazyDocument::TrimBegin(size_t nBegin, size_t nEnd) const
+{
+   while (nBegin != nEnd && Scanner::IsWhiteSpace(m_pData[nBegin]))
+      ++nBegin;
+   return nBegin;
+}
+
+inline size_t LazyDocument::TrimEnd(size_t nBegin, size_t nEnd) const
+{
+   while (nEnd != nBegin && Scanner::IsWhiteSpace(m_pData[nEnd - 1]))
+      --nEnd;
+   return nEnd;
+}
+
+
+inline Reader::Location LazyDocument::LocationOf(size_t nOffset) const
+{
+   // only needed for error reporting, so counting lines the slow way is fine
+   Reader::Location location;
+   const char* pLineBegin = m_pData;
+   for (const char* p = m_pData; p != m_pData + nOffset; ++p)
+   {
+      if (*p == '\n') {
+         ++location.m_nLine;
+         pLineBegin = p + 1;
+      }
+   }
+   location.m_nLineOffset = m_pData + nOffset - pLineBegin;
+   location.m_nDocOffset = nOffset;
+   return location;
+}
+
+
+inline Reader::Location LazyDocument::Relocate(const Reader::Location& location, size_t nBase) const
+{
+   // turns a location relative to nBase into one relative to the whole document
+   Reader::Location base = LocationOf(nBase);
+   Reader::Location result = location;
+   result.m_nLine += base.m_nLine;
+   if (location.m_nLine == 0)
+      result.m_nLineOffset += base.m_nLineOffset;
+   result.m_nDocOffset += base.m_nDocOffset;
+   return result;
+}
+
+
+} // End namespace
@@ -0,0 +1,187 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace json
+{
+
+class NameTable;
+
+
+/////////////////////////////////////////////////////////////////////////
+// Name - an object member name. Reference counted, so copies share one 
+//  buffer, & the hash is worked out just once. Names interned by a NameTable
+//  are unique within that table, which lets comparisons between them get away 
+//  with comparing pointers. Stands in for std::string: it converts to const 
+//  std::string&, can be assigned or appended to (which gives it a buffer of 
+//  its own), and has std::string's usual read-only members & operators.
+
+class Name
+{
+public:
+   Name();
+   Name(const std::string& sName);
+   Name(const char* name);
+   Name(const char* name, size_t nLength);
+   Name(const Name& name);
+   Name(Name&& name) noexcept;
+
+   ~Name();
+
+   Name& operator = (const Name& name);
+   Name& operator = (Name&& name) noexcept;
+
+   Name& operator += (const std::string& sName);
+   Name& operator += (const char* szName);
+   Name& operator += (char c);
+
+   void Swap(Name& name) noexcept;
+
+   operator const std::string& () const;
+   const std::string& Value() const;
+
+   // std::string style shortcuts
+   typedef std::string::const_iterator const_iterator;
+
+   const char* c_str() const;
+   const char* data() const;
+   size_t size() const;
+   size_t length() const;
+   bool empty() const;
+   const_iterator begin() const;
+   const_iterator end() const;
+   char operator[] (size_t nIndex) const;
+   int compare(const std::string& sName) const;
+   size_t find(const std::string& sName, size_t nPosition = 0) const;
+   size_t find(char c, size_t nPosition = 0) const;
+   std::string substr(size_t nPosition = 0, size_t nLength = std::string::npos) const;
+
+   size_t Hash() const;
+   bool IsInterned() const;
+
+   bool operator == (const Name& name) const;
+   bool operator != (const Name& name) const;
+   bool operator < (const Name& name) const;
+   bool operator <= (const Name& name) const;
+   bool operator > (const Name& name) const;
+   bool operator >= (const Name& name) const;
+
+   // the hash function used for names (FNV-1a)
+   static size_t Hash(const char* name, size_t nLength);
+
+private:
+   friend class NameTable;
+
+   struct Shared;
+
+   explicit Name(Shared* pShared);     // takes over a reference
+
+   Shared* m_pShared;                  // 0 for the empty name
+};
+
+bool operator == (const Name& name, const std::string& sName);
+bool operator == (const std::string& sName, const Name& name);
+bool operator == (const Name& name, const char* szName);
+bool operator == (const char* szName, const Name& name);
+bool operator != (const Name& name, const std::string& sName);
+bool operator != (const std::string& sName, const Name& name);
+bool operator != (const Name& name, const char* szName);
+bool operator != (const char* szName, const Name& name);
+
+std::string operator + (const Name& name, const std::string& sName);
+std::string operator + (const std::string& sName, const Name& name);
+std::string operator + (const Name& name, const char* szName);
+std::string operator + (const char* szName, const Name& name);
+
+std::ostream& operator << (std::ostream& ostr, const Name& name);
+
+void swap(Name& left, Name& right) noexcept;
+
+
+
+/////////////////////////////////////////////////////////////////////////
+// NameTable - interns member names, so each distinct name is stored once no
+//  matter how many objects use it. Interning is optional: Reader only interns
+//  the names it reads when given a table, through a Document, RecordReader,
+//  PushReader or ParallelReader. A table can be shared between any number of
+//  them, in which case it should be made thread-safe if they're used on 
+//  different threads:
+//
+//  NameTable names(true);
+//  Document document(names);
+//  Reader::Read(document, sRecord);
+//
+// Names already handed out stay valid after the table is cleared or 
+//  destroyed. To keep a long-lived table from growing without bound, only
+//  the first MAX_NAMES distinct names are interned; later ones are still 
+//  fine, they just aren't shared.
+
+class NameTable
+{
+public:
+   enum { MAX_NAMES = 65536 };
+
+   explicit NameTable(bool bThreadSafe = false);
+   ~NameTable();
+
+   Name Intern(const char* name, size_t nLength);
+   Name Intern(const std::string& sName);
+
+   size_t Size() const;
+   void Clear();
+
+private:
+   NameTable(const NameTable&);               // not copyable
+   NameTable& operator = (const NameTable&);
+
+   Name Find(const char* name, size_t nLength, size_t nHash);
+   void Grow();
+
+   static size_t NextId();
+
+   std::vector<Name::Shared*> m_Slots;       // open addressing (linear probing)
+   size_t m_nSize;
+   size_t m_nId;                             // tags our names; never 0
+   bool m_bThreadSafe;
+   mutable std::mutex m_Mutex;
+};
+
+
+} // End namespace
+
+
+#include "names.inl"
@@ -0,0 +1,331 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <cstring>
+#include <ostream>
+
+namespace json
+{
+
+
+////////////////////////
+// Name::Shared members
+
+struct Name::Shared
+{
+   Shared(const char* name, size_t nLength, size_t nHashIn, size_t nTableIn) :
+      nReferences(1),
+      nHash(nHashIn),
+      nTable(nTableIn),
+      sValue(name, nLength) {}
+
+   std::atomic<size_t> nReferences;
+   size_t nHash;
+   size_t nTable;          // id of the interning table, or 0
+   std::string sValue;
+};
+
+
+////////////////
+// Name members
+
+inline Name::Name() : m_pShared(0) {}
+
+inline Name::Name(const std::string& sName) : 
+   m_pShared(sName.empty() ? 0 : new Shared(sName.data(), sName.size(), Hash(sName.data(), sName.size()), 0)) {}
+
+inline Name::Name(const char* name) : 
+   m_pShared(0)
+{
+   size_t nLength = std::strlen(name);
+   if (nLength)
+      m_pShared = new Shared(name, nLength, Hash(name, nLength), 0);
+}
+
+inline Name::Name(const char* name, size_t nLength) : 
+   m_pShared(nLength ? new Shared(name, nLength, Hash(name, nLength), 0) : 0) {}
+
+inline Name::Name(const Name& name) :
+   m_pShared(name.m_pShared)
+{
+   if (m_pShared)
+      m_pShared->nReferences.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline Name::Name(Name&& name) noexcept :
+   m_pShared(name.m_pShared)
+{
+   name.m_pShared = 0;
+}
+
+inline Name::Name(Shared* pShared) : m_pShared(pShared) {}
+
+inline Name::~Name()
+{
+   if (m_pShared && m_pShared->nReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete m_pShared;
+}
+
+inline Name& Name::operator = (const Name& name)
+{
+   Name copy(name);
+   Swap(copy);
+   return *this;
+}
+
+inline Name& Name::operator = (Name&& name) noexcept
+{
+   Name taken(std::move(name));
+   Swap(taken);
+   return *this;
+}
+
+inline Name& Name::operator += (const std::string& sName)
+{
+   // the buffer may be shared (or interned), so the result gets one of its own
+   return *this = Name(Value() + sName);
+}
+
+inline Name& Name::operator += (const char* szName)   { return *this += std::string(szName); }
+inline Name& Name::operator += (char c)               { return *this += std::string(1, c); }
+
+inline void Name::Swap(Name& name) noexcept
+{
+   std::swap(m_pShared, name.m_pShared);
+}
+
+inline Name::operator const std::string& () const { return Value(); }
+
+inline const std::string& Name::Value() const
+{
+   static const std::string sEmpty;
+   return m_pShared ? m_pShared->sValue : sEmpty;
+}
+
+inline const char* Name::c_str() const    { return m_pShared ? m_pShared->sValue.c_str() : ""; }
+inline const char* Name::data() const     { return m_pShared ? m_pShared->sValue.data() : ""; }
+inline size_t Name::size() const          { return m_pShared ? m_pShared->sValue.size() : 0; }
+inline size_t Name::length() const        { return size(); }
+inline bool Name::empty() const           { return m_pShared == 0; }
+
+inline Name::const_iterator Name::begin() const     { return Value().begin(); }
+inline Name::const_iterator Name::end() const       { return Value().end(); }
+inline char Name::operator[] (size_t nIndex) const  { return Value()[nIndex]; }
+
+inline int Name::compare(const std::string& sName) const                  { return Value().compare(sName); }
+inline size_t Name::find(const std::string& sName, size_t nPosition) const  { return Value().find(sName, nPosition); }
+inline size_t Name::find(char c, size_t nPosition) const                    { return Value().find(c, nPosition); }
+inline std::string Name::substr(size_t nPosition, size_t nLength) const     { return Value().substr(nPosition, nLength); }
+
+inline size_t Name::Hash() const
+{
+   return m_pShared ? m_pShared->nHash : Hash("", 0);
+}
+
+inline bool Name::IsInterned() const
+{
+   return m_pShared && m_pShared->nTable != 0;
+}
+
+inline bool Name::operator == (const Name& name) const
+{
+   if (m_pShared == name.m_pShared)
+      return true;
+   if (m_pShared == 0 || name.m_pShared == 0)
+      return false;
+
+   // a table never interns the same name twice
+   if (m_pShared->nTable != 0 && m_pShared->nTable == name.m_pShared->nTable)
+      return false;
+
+   return m_pShared->nHash == name.m_pShared->nHash &&
+          m_pShared->sValue == name.m_pShared->sValue;
+}
+
+inline bool Name::operator != (const Name& name) const  { return !(*this == name); }
+inline bool Name::operator < (const Name& name) const   { return Value() < name.Value(); }
+inline bool Name::operator <= (const Name& name) const  { return !(name < *this); }
+inline bool Name::operator > (const Name& name) const   { return name < *this; }
+inline bool Name::operator >= (const Name& name) const  { return !(*this < name); }
+
+inline size_t Name::Hash(const char* name, size_t nLength)
+{
+   // FNV-1a
+   size_t nHash = static_cast<size_t>(14695981039346656037ULL);
+   for (size_t n = 0; n < nLength; ++n)
+   {
+      nHash ^= static_cast<unsigned char>(name[n]);
+      nHash *= static_cast<size_t>(1099511628211ULL);
+   }
+   return nHash;
+}
+
+inline bool operator == (const Name& name, const std::string& sName)    { return name.Value() == sName; }
+inline bool operator == (const std::string& sName, const Name& name)    { return name.Value() == sName; }
+inline bool operator == (const Name& name, const char* szName)          { return name.Value() == szName; }
+inline bool operator == (const char* szName, const Name& name)          { return name.Value() == szName; }
+inline bool operator != (const Name& name, const std::string& sName)    { return !(name == sName); }
+inline bool operator != (const std::string& sName, const Name& name)    { return !(name == sName); }
+inline bool operator != (const Name& name, const char* szName)          { return !(name == szName); }
+inline bool operator != (const char* szName, const Name& name)          { return !(name == szName); }
+
+inline std::string operator + (const Name& name, const std::string& sName)   { return name.Value() + sName; }
+inline std::string operator + (const std::string& sName, const Name& name)   { return sName + name.Value(); }
+inline std::string operator + (const Name& name, const char* szName)         { return name.Value() + szName; }
+inline std::string operator + (const char* szName, const Name& name)         { return szName + name.Value(); }
+
+inline std::ostream& operator << (std::ostream& ostr, const Name& name)
+{
+   return ostr << name.Value();
+}
+
+inline void swap(Name& left, Name& right) noexcept { left.Swap(right); }
+
+
+/////////////////////
+// NameTable members
+
+inline NameTable::NameTable(bool bThreadSafe) :
+   m_nSize(0),
+   m_nId(NextId()),
+   m_bThreadSafe(bThreadSafe) {}
+
+inline NameTable::~NameTable()
+{
+   Clear();
+}
+
+inline Name NameTable::Intern(const std::string& sName)
+{
+   return Intern(sName.data(), sName.size());
+}
+
+inline Name NameTable::Intern(const char* name, size_t nLength)
+{
+   if (nLength == 0)
+      return Name();
+
+   size_t nHash = Name::Hash(name, nLength);
+   if (m_bThreadSafe == false)
+      return Find(name, nLength, nHash);
+
+   std::lock_guard<std::mutex> lock(m_Mutex);
+   return Find(name, nLength, nHash);
+}
+
+inline size_t NameTable::Size() const
+{
+   if (m_bThreadSafe == false)
+      return m_nSize;
+
+   std::lock_guard<std::mutex> lock(m_Mutex);
+   return m_nSize;
+}
+
+inline void NameTable::Clear()
+{
+   std::unique_lock<std::mutex> lock(m_Mutex, std::defer_lock);
+   if (m_bThreadSafe)
+      lock.lock();
+
+   // we hold one reference to each; whoever else holds one keeps the name alive
+   for (size_t n = 0; n < m_Slots.size(); ++n)
+      Name release(m_Slots[n]);
+
+   m_Slots.clear();
+   m_nSize = 0;
+
+   // names interned from now on mustn't be mistaken for different ones from before
+   m_nId = NextId();
+}
+
+inline Name NameTable::Find(const char* name, size_t nLength, size_t nHash)
+{
+   if (m_Slots.empty() == false)
+   {
+      size_t nMask = m_Slots.size() - 1;
+      for (size_t n = nHash & nMask; m_Slots[n] != 0; n = (n + 1) & nMask)
+      {
+         Name::Shared* pShared = m_Slots[n];
+         if (pShared->nHash == nHash && 
+             pShared->sValue.size() == nLength &&
+             std::memcmp(pShared->sValue.data(), name, nLength) == 0)
+         {
+            pShared->nReferences.fetch_add(1, std::memory_order_relaxed);
+            return Name(pShared);
+         }
+      }
+   }
+
+   // full up? then it just isn't interned
+   if (m_nSize >= MAX_NAMES)
+      return Name(new Name::Shared(name, nLength, nHash, 0));
+
+   if ((m_nSize + 1) * 2 > m_Slots.size())
+      Grow();
+
+   size_t nMask = m_Slots.size() - 1;
+   size_t n = nHash & nMask;
+   while (m_Slots[n] != 0)
+      n = (n + 1) & nMask;
+
+   // one reference for the table, one for the caller
+   Name::Shared* pShared = new Name::Shared(name, nLength, nHash, m_nId);
+   pShared->nReferences.store(2, std::memory_order_relaxed);
+   m_Slots[n] = pShared;
+   ++m_nSize;
+   return Name(pShared);
+}
+
+inline void NameTable::Grow()
+{
+   std::vector<Name::Shared*> slots(m_Slots.empty() ? 64 : m_Slots.size() * 2, static_cast<Name::Shared*>(0));
+   slots.swap(m_Slots);
+
+   size_t nMask = m_Slots.size() - 1;
+   for (size_t n = 0; n < slots.size(); ++n)
+   {
+      if (slots[n] == 0)
+         continue;
+
+      size_t nSlot = slots[n]->nHash & nMask;
+      while (m_Slots[nSlot] != 0)
+         nSlot = (nSlot + 1) & nMask;
+      m_Slots[nSlot] = slots[n];
+   }
+}
+
+inline size_t NameTable::NextId()
+{
+   static std::atomic<size_t> nNextId(1);
+   return nNextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+} // End namespace
@@ -0,0 +1,97 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include "elements.h"
+#include "reader.h"
+#include <string>
+#include <vector>
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// ParallelReader - reads a document whose root is a (large) array on several
+//  threads at once. A quick structural pass splits the buffer between top-level
+//  elements, honoring strings & nesting; the pieces are then parsed concurrently
+//  straight into their slots, so the elements come out in document order. Only 
+//  worth it for documents of a megabyte or more - small arrays are simply read 
+//  on the calling thread.
+//
+//  ParallelReader reader(8);
+//  Array arrayRecords;
+//  reader.ReadFile(arrayRecords, "records.json");
+//
+// Given a NameTable, member names are interned in it by every thread, so the 
+//  records share their names just as if they'd been read sequentially. The 
+//  table has to be thread-safe (NameTable names(true)).
+//
+// Like Reader, elements are appended to the array, and an array that starts out 
+//  empty & is read as nothing but numbers is packed. A malformed document is reread
+//  sequentially, so the exception thrown is exactly the one Reader would throw.
+
+class ParallelReader
+{
+public:
+   // nThreads == 0 uses one thread per hardware core
+   explicit ParallelReader(unsigned int nThreads = 0);
+   ParallelReader(unsigned int nThreads, NameTable& names);   // names must outlive the reader
+
+   unsigned int Threads() const;
+
+   void Read(Array& array, const char* pData, size_t nLength) const;
+   void Read(Array& array, const std::string& sDocument) const;
+   void ReadFile(Array& array, const char* sPath) const;
+
+private:
+   // a run of consecutive top-level elements, without the commas on either end
+   struct Chunk
+   {
+      const char* pBegin;
+      const char* pEnd;
+      size_t nFirst;       // index of the chunk's first element within the array
+      size_t nElements;
+   };
+
+   typedef std::vector<Chunk> Chunks;
+
+   bool Split(const char* pData, size_t nLength, Chunks& chunks) const;
+   bool ParseChunk(Array::iterator itElement, const Chunk& chunk) const;
+   void ReadSequential(Array& array, const char* pData, size_t nLength) const;
+
+   unsigned int m_nThreads;
+   NameTable* m_pNames;
+};
+
+
+} // End namespace
+
+
+#include "parallelreader.inl"
@@ -0,0 +1,263 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace json
+{
+
+
+inline ParallelReader::ParallelReader(unsigned int nThreads) :
+   m_nThreads(nThreads),
+   m_pNames(0)
+{
+   if (m_nThreads == 0)
+      m_nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+inline ParallelReader::ParallelReader(unsigned int nThreads, NameTable& names) :
+   m_nThreads(nThreads),
+   m_pNames(&names)
+{
+   if (m_nThreads == 0)
+      m_nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+inline unsigned int ParallelReader::Threads() const
+{
+   return m_nThreads;
+}
+
+
+inline void ParallelReader::Read(Array& array, const std::string& sDocument) const
+{
+   Read(array, sDocument.data(), sDocument.size());
+}
+
+
+inline void ParallelReader::Read(Array& array, const char* pData, size_t nLength) const
+{
+   // anything we can't split (too small, not an array, malformed...) is left to Reader
+   Chunks chunks;
+   if (m_nThreads < 2 || Split(pData, nLength, chunks) == false)
+   {
+      ReadSequential(array, pData, nLength);
+      return;
+   }
+
+   size_t nBase = array.Size();
+   array.Resize(nBase + chunks.back().nFirst + chunks.back().nElements);
+   Array::iterator itBase = array.Begin() + nBase;
+
+   // there are several chunks per thread, so a slow one doesn't hold everyone up. 
+   //  threads just grab the next chunk when done with the last one
+   std::atomic<size_t> nNextChunk(0);
+   std::atomic<bool> bFailed(false);
+   auto work = [&]() {
+      size_t nChunk;
+      while (bFailed == false &&
+             (nChunk = nNextChunk++) < chunks.size())
+      {
+         const Chunk& chunk = chunks[nChunk];
+         if (ParseChunk(itBase + chunk.nFirst, chunk) == false)
+            bFailed = true;
+      }
+   };
+
+   std::vector<std::thread> threads;
+   size_t nThreads = std::min<size_t>(m_nThreads, chunks.size());
+   for (size_t n = 1; n < nThreads; ++n)
+   {
+      try {
+         threads.push_back(std::thread(work));
+      }
+      catch (...) {
+         break; // out of threads? make do with what we've got
+      }
+   }
+
+   work(); // the calling thread pitches in too
+   for (size_t n = 0; n < threads.size(); ++n)
+      threads[n].join();
+
+   // something's wrong with the document. read it again the ordinary way, which will
+   //  throw the same exception (& location) as it always would
+   if (bFailed)
+   {
+      array.Resize(nBase);
+      ReadSequential(array, pData, nLength);
+   }
+
+   // the slots were filled in one by one, so an array of nothing but numbers ends 
+   //  up packed only now, same as Reader would have read it
+   else if (nBase == 0)
+      array.Pack();
+}
+
+
+inline void ParallelReader::ReadFile(Array& array, const char* sPath) const
+{
+   Reader::MappedFile mappedFile(sPath);
+   if (mappedFile.IsMapped())
+      Read(array, mappedFile.Begin(), mappedFile.End() - mappedFile.Begin());
+   else
+   {
+      // can't be mapped, so load it all up front
+      std::ifstream ifStr(sPath, std::ios::in | std::ios::binary);
+      if (ifStr.is_open() == false)
+         throw Exception(std::string("Unable to open file: ") + sPath);
+
+      std::string sDocument((std::istreambuf_iterator<char>(ifStr)), std::istreambuf_iterator<char>());
+      Read(array, sDocument);
+   }
+}
+
+
+inline bool ParallelReader::Split(const char* pData, size_t nLength, Chunks& chunks) const
+{
+   const char* p = pData;
+   const char* pEnd = pData + nLength;
+   while (p != pEnd && Scanner::IsWhiteSpace(*p))
+      ++p;
+   if (p == pEnd || *p != '[')
+      return false;
+   ++p;
+
+   // aim for several chunks per thread, but don't bother splitting hairs
+   const size_t nMinChunkSize = 64 * 1024;
+   size_t nChunkSize = std::max<size_t>(nLength / (m_nThreads * 8), nMinChunkSize);
+
+   Chunk chunk;
+   chunk.pBegin = p;
+   chunk.nFirst = 0;
+   chunk.nElements = 1;
+
+   // find the top-level commas. nesting depth is all that matters here; whether the
+   //  brackets actually pair up is checked when the chunks are parsed
+   size_t nDepth = 0;
+   while (true)
+   {
+      if (p == pEnd)
+         return false; // never closed
+
+      char c = *p;
+      if (c == '"')
+      {
+         ++p;
+         while (true)
+         {
+            p = Scanner::FindStringSpecial(p, pEnd);
+            if (p == pEnd)
+               return false;
+            if (*p == '"')
+               break;
+            p += (*p == '\\' && p + 1 != pEnd) ? 2 : 1;
+         }
+      }
+      else if (c == '{' || c == '[')
+         ++nDepth;
+      else if (c == '}' || c == ']')
+      {
+         if (nDepth == 0)
+         {
+            if (c != ']')
+               return false;
+            break;
+         }
+         --nDepth;
+      }
+      else if (c == ',' && nDepth == 0)
+      {
+         if (static_cast<size_t>(p - chunk.pBegin) >= nChunkSize)
+         {
+            chunk.pEnd = p;
+            chunks.push_back(chunk);
+
+            chunk.pBegin = p + 1;
+            chunk.nFirst += chunk.nElements;
+            chunk.nElements = 0;
+         }
+         ++chunk.nElements;
+      }
+
+      ++p;
+   }
+
+   chunk.pEnd = p;
+   chunks.push_back(chunk);
+
+   // nothing but white space allowed after the root element
+   for (++p; p != pEnd; ++p)
+   {
+      if (Scanner::IsWhiteSpace(*p) == false)
+         return false;
+   }
+
+   // one chunk isn't worth the threads
+   return chunks.size() > 1;
+}
+
+
+inline bool ParallelReader::ParseChunk(Array::iterator itElement, const Chunk& chunk) const
+{
+   // any failure here is reported (properly) by the sequential reread, so 
+   //  there's no need to pass the exception on
+   try
+   {
+      Reader reader;
+      reader.m_pNames = m_pNames;
+      Reader::InputStream inputStream(chunk.pBegin, chunk.pEnd);
+      for (size_t n = 0; n < chunk.nElements; ++n, ++itElement)
+      {
+         if (n != 0)
+            reader.MatchExpectedToken(',', inputStream);
+         reader.Parse(*itElement, inputStream);
+         reader.EatWhiteSpace(inputStream);
+      }
+      return inputStream.EOS();
+   }
+   catch (...)
+   {
+      return false;
+   }
+}
+
+
+inline void ParallelReader::ReadSequential(Array& array, const char* pData, size_t nLength) const
+{
+   Reader::InputStream inputStream(pData, pData + nLength);
+   Reader::Read_i(array, inputStream, m_pNames);
+}
+
+
+} // End namespace
@@ -0,0 +1,154 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include "elements.h"
+#include "reader.h"
+#include "visitor.h"
+#include <string>
+#include <vector>
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// PushReader - reads a document that arrives a piece at a time (i.e. off a 
+//  socket), without blocking for the rest of it. Each Feed() picks up exactly
+//  where the previous one left off, even in the middle of a string, number or
+//  escape sequence. Errors are reported with the same exceptions as Reader.
+//
+//  PushReader reader;
+//  while (reader.Feed(pChunk, nChunkLength) == false) 
+//     ...wait for the next chunk...
+//  const UnknownElement& elemRoot = reader.Root();
+//
+// A number at the document root has nothing after it to mark its end, so call
+//  Finish() once the input is exhausted; it also verifies the document is whole.
+
+class PushReader
+{
+public:
+   // builds the document into Root(), interning member names in a table if given
+   //  one (see NameTable)...
+   PushReader();
+   explicit PushReader(NameTable& names);
+
+   // ...or pushes it to a handler instead, without building anything
+   PushReader(Handler& handler);
+
+   ~PushReader();
+
+   // consumes the next piece of the document. returns true once the root element 
+   //  is complete; anything but white space after that is an error
+   bool Feed(const char* pData, size_t nLength);
+   bool Feed(const std::string& sData);
+
+   // signals the end of input. throws if the document isn't complete
+   void Finish();
+
+   bool IsComplete() const;
+   const Reader::Location& GetLocation() const;
+
+   UnknownElement& Root();
+   const UnknownElement& Root() const;
+
+   // forgets everything read so far, so another document can be fed
+   void Reset();
+
+private:
+   class Builder;
+
+   enum State
+   {
+      STATE_VALUE,         // value expected: document root, after ':' or after ',' in an array
+      STATE_FIRST_VALUE,   // value or ']' expected, right after '['
+      STATE_FIRST_KEY,     // member name or '}' expected, right after '{'
+      STATE_KEY,           // member name expected, after ',' in an object
+      STATE_COLON,         // ':' expected, after a member name
+      STATE_NEXT,          // ',' or closing bracket expected, after a value in a container
+      STATE_DONE           // root element complete
+   };
+
+   enum Lexeme
+   {
+      LEXEME_NONE,         // between tokens
+      LEXEME_STRING,       // inside "..."
+      LEXEME_ESCAPE,       // right after '\' inside a string
+      LEXEME_UNICODE,      // inside the hex digits of "\uXXXX"
+      LEXEME_NUMBER,
+      LEXEME_LITERAL       // true, false or null
+   };
+
+   PushReader(const PushReader&);               // not copyable
+   PushReader& operator = (const PushReader&);
+
+   const char* ScanString(const char* p, const char* pEnd);
+   const char* ScanNumber(const char* p, const char* pEnd);
+   const char* ScanLiteral(const char* p, const char* pEnd);
+
+   void BeginValue(char c);
+   void BeginKey(char c);
+   void EndValue();
+   void EndString();
+   void EndNumber();
+   void EndContainer(char c);
+   void EndCodeUnit();
+   void FlushHighSurrogate();
+
+   void Step(char c);
+   void ThrowUnexpected(const std::string& sPrefix, char c);
+
+   UnknownElement m_Root;
+   Builder* m_pBuilder;             // null when feeding a user handler
+   Handler* m_pHandler;
+
+   State m_nState;
+   Lexeme m_nLexeme;
+   std::vector<char> m_Containers;  // '{' or '[' for each open container
+
+   // token in progress
+   Reader::Location m_locTokenBegin;
+   bool m_bKey;
+   String m_String;
+   std::string m_sNumber;
+   const char* m_sLiteral;
+   size_t m_nLiteralLength;
+   unsigned int m_nCodeUnit;
+   unsigned int m_nHexDigits;
+   unsigned int m_nHighSurrogate;   // awaiting its low surrogate, or zero
+
+   Reader::Location m_Location;
+};
+
+
+} // End namespace
+
+
+#include "pushreader.inl"
@@ -0,0 +1,576 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include <cstring>
+
+namespace json
+{
+
+
+///////////////////////
+// PushReader::Builder
+
+// assembles the element tree from the events PushReader produces
+
+class PushReader::Builder : public Handler
+{
+public:
+   Builder(UnknownElement& root, const PushReader& reader, NameTable* pNames) : 
+      m_Root(root), m_Reader(reader), m_pMember(0), m_pNames(pNames) {}
+
+   void Reset() {
+      m_Containers.clear();
+      m_pMember = 0;
+   }
+
+   virtual void BeginObject() {
+      Object& object = Slot().EmplaceObject(0);
+      m_Containers.push_back(Container(0, &object));
+   }
+
+   virtual void Key(const std::string& name) {
+      // looked up first so a duplicate is reported as a parse error, as Reader does
+      Object& object = *m_Containers.back().pObject;
+      Name nameMember = m_pNames ? m_pNames->Intern(name) : Name(name);
+      if (object.Position(nameMember) != Object::Index::NOT_FOUND)
+      {
+         std::string sMessage = std::string("Duplicate object member token: ") + name; 
+         throw Reader::ParseException(sMessage, m_Reader.m_locTokenBegin, m_Reader.m_Location);
+      }
+      m_pMember = &object.Append(Object::Member(std::move(nameMember)))->element;
+   }
+
+   virtual void EndObject()                  { m_Containers.pop_back(); }
+
+   virtual void BeginArray() {
+      Array& array = Slot().EmplaceArray(0);
+      m_Containers.push_back(Container(&array, 0));
+   }
+
+   virtual void EndArray()                   { m_Containers.pop_back(); }
+
+   virtual void Value(const Number& number)     { Slot() = number; }
+   virtual void Value(const String& string)     { Slot() = string; }
+   virtual void Value(const Boolean& boolean)   { Slot() = boolean; }
+   virtual void Value(const Null& null)         { Slot() = null; }
+
+private:
+   struct Container
+   {
+      Container(Array* pArrayIn, Object* pObjectIn) : pArray(pArrayIn), pObject(pObjectIn) {}
+      Array* pArray;
+      Object* pObject;
+   };
+
+   // where the next value goes
+   UnknownElement& Slot() {
+      if (m_Containers.empty())
+         return m_Root;
+      if (m_Containers.back().pArray)
+         return *m_Containers.back().pArray->Insert(UnknownElement());
+      return *m_pMember;
+   }
+
+   UnknownElement& m_Root;
+   const PushReader& m_Reader;   // for error locations
+   std::vector<Container> m_Containers;
+   UnknownElement* m_pMember;
+   NameTable* m_pNames;       // where member names are interned, if anywhere
+};
+
+
+
+///////////////
+// PushReader
+
+inline PushReader::PushReader() :
+   m_pBuilder(new Builder(m_Root, *this, 0)),
+   m_pHandler(m_pBuilder)
+{
+   Reset();
+}
+
+inline PushReader::PushReader(NameTable& names) :
+   m_pBuilder(new Builder(m_Root, *this, &names)),
+   m_pHandler(m_pBuilder)
+{
+   Reset();
+}
+
+inline PushReader::PushReader(Handler& handler) :
+   m_pBuilder(0),
+   m_pHandler(&handler)
+{
+   Reset();
+}
+
+inline PushReader::~PushReader()
+{
+   delete m_pBuilder;
+}
+
+inline void PushReader::Reset()
+{
+   m_Root = UnknownElement();
+   if (m_pBuilder)
+      m_pBuilder->Reset();
+
+   m_nState = STATE_VALUE;
+   m_nLexeme = LEXEME_NONE;
+   m_Containers.clear();
+   m_nHighSurrogate = 0;
+   m_Location = Reader::Location();
+}
+
+inline bool PushReader::IsComplete() const                        { return m_nState == STATE_DONE; }
+inline const Reader::Location& PushReader::GetLocation() const    { return m_Location; }
+
+inline UnknownElement& PushReader::Root()                         { return m_Root; }
+inline const UnknownElement& PushReader::Root() const             { return m_Root; }
+
+inline bool PushReader::Feed(const std::string& sData)            { return Feed(sData.data(), sData.size()); }
+
+
+inline bool PushReader::Feed(const char* pData, size_t nLength)
+{
+   const char* p = pData;
+   const char* pEnd = pData + nLength;
+   while (p != pEnd)
+   {
+      // finish whatever token the last chunk ended in the middle of
+      switch (m_nLexeme)
+      {
+         case LEXEME_STRING:
+         case LEXEME_ESCAPE:
+         case LEXEME_UNICODE:
+            p = ScanString(p, pEnd);
+            continue;
+
+         case LEXEME_NUMBER:
+            p = ScanNumber(p, pEnd);
+            continue;
+
+         case LEXEME_LITERAL:
+            p = ScanLiteral(p, pEnd);
+            continue;
+
+         default:
+            break;
+      }
+
+      // between tokens, so white space is allowed...
+      if (Scanner::IsWhiteSpace(*p))
+      {
+         size_t nLines = 0;
+         const char* pLastNewLine = 0;
+         const char* pNext = Scanner::SkipWhiteSpace(p, pEnd, nLines, pLastNewLine);
+         m_Location.m_nDocOffset += pNext - p;
+         if (nLines != 0) {
+            m_Location.m_nLine += nLines;
+            m_Location.m_nLineOffset = pNext - pLastNewLine - 1;
+         }
+         else
+            m_Location.m_nLineOffset += pNext - p;
+         p = pNext;
+         continue;
+      }
+
+      // ...otherwise, it's the first character of the next token
+      m_locTokenBegin = m_Location;
+      char c = *p++;
+      Step(c);
+
+      switch (m_nState)
+      {
+         case STATE_VALUE:
+            BeginValue(c);
+            break;
+
+         case STATE_FIRST_VALUE:
+            if (c == ']')
+               EndContainer(c);
+            else
+               BeginValue(c);
+            break;
+
+         case STATE_FIRST_KEY:
+            if (c == '}')
+               EndContainer(c);
+            else
+               BeginKey(c);
+            break;
+
+         case STATE_KEY:
+            BeginKey(c);
+            break;
+
+         case STATE_COLON:
+            if (c != ':')
+               ThrowUnexpected("Unexpected token: ", c);
+            m_nState = STATE_VALUE;
+            break;
+
+         case STATE_NEXT:
+         {
+            bool bObject = (m_Containers.back() == '{');
+            if (c == ',')
+               m_nState = (bObject ? STATE_KEY : STATE_VALUE);
+            else if (c == (bObject ? '}' : ']'))
+               EndContainer(c);
+            else
+               ThrowUnexpected("Unexpected token: ", c);
+            break;
+         }
+
+         case STATE_DONE:
+            ThrowUnexpected("Expected End of token stream; found ", c);
+      }
+   }
+
+   return IsComplete();
+}
+
+
+inline void PushReader::Finish()
+{
+   // a number is only over once something else shows up, or the input ends
+   if (m_nLexeme == LEXEME_NUMBER)
+      EndNumber();
+
+   if (m_nLexeme == LEXEME_LITERAL)
+      throw Reader::ScanException(std::string("Expected string: ") + m_sLiteral, m_Location);
+   if (m_nLexeme != LEXEME_NONE)
+      throw Reader::ScanException("Expected string: \"", m_Location);
+   if (IsComplete() == false)
+      throw Reader::ParseException("Unexpected end of token stream", m_Location, m_Location);
+}
+
+
+inline void PushReader::BeginValue(char c)
+{
+   switch (c)
+   {
+      case '{':
+         m_pHandler->BeginObject();
+         m_Containers.push_back(c);
+         m_nState = STATE_FIRST_KEY;
+         break;
+
+      case '[':
+         m_pHandler->BeginArray();
+         m_Containers.push_back(c);
+         m_nState = STATE_FIRST_VALUE;
+         break;
+
+      case '"':
+         m_bKey = false;
+         m_String.Value().clear();
+         m_nLexeme = LEXEME_STRING;
+         break;
+
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+         m_sNumber.assign(1, c);
+         m_nLexeme = LEXEME_NUMBER;
+         break;
+
+      case 't':
+      case 'f':
+      case 'n':
+         m_sLiteral = (c == 't' ? "true" : c == 'f' ? "false" : "null");
+         m_nLiteralLength = 1;
+         m_nLexeme = LEXEME_LITERAL;
+         break;
+
+      default:
+         ThrowUnexpected("Unexpected token: ", c);
+   }
+}
+
+
+inline void PushReader::BeginKey(char c)
+{
+   if (c != '"')
+      ThrowUnexpected("Unexpected token: ", c);
+   m_bKey = true;
+   m_String.Value().clear();
+   m_nLexeme = LEXEME_STRING;
+}
+
+
+inline void PushReader::EndValue()
+{
+   m_nState = (m_Containers.empty() ? STATE_DONE : STATE_NEXT);
+}
+
+
+inline void PushReader::EndContainer(char c)
+{
+   m_Containers.pop_back();
+   if (c == '}')
+      m_pHandler->EndObject();
+   else
+      m_pHandler->EndArray();
+   EndValue();
+}
+
+
+inline const char* PushReader::ScanString(const char* p, const char* pEnd)
+{
+   std::string& sValue = m_String.Value();
+   while (p != pEnd)
+   {
+      if (m_nLexeme == LEXEME_STRING)
+      {
+         // plain characters are copied over in bulk (no newlines among them)...
+         const char* pRunEnd = Scanner::FindStringSpecial(p, pEnd);
+         if (pRunEnd != p)
+         {
+            FlushHighSurrogate();
+            sValue.append(p, pRunEnd);
+            m_Location.m_nDocOffset += pRunEnd - p;
+            m_Location.m_nLineOffset += pRunEnd - p;
+            p = pRunEnd;
+            continue;
+         }
+
+         // ...up to the closing quote, an escape, or a control character
+         char c = *p++;
+         Step(c);
+         if (c == '"') {
+            FlushHighSurrogate();
+            EndString();
+            break;
+         }
+         else if (c == '\\')
+            m_nLexeme = LEXEME_ESCAPE;
+         else {
+            FlushHighSurrogate();
+            sValue.push_back(c);
+         }
+      }
+      else if (m_nLexeme == LEXEME_ESCAPE)
+      {
+         char c = *p++;
+         Step(c);
+         if (m_nHighSurrogate != 0 && c != 'u')
+            throw Reader::ScanException("Expected string: \\u", m_Location);
+
+         m_nLexeme = LEXEME_STRING;
+         switch (c) {
+            case '/':      sValue.push_back('/');     break;
+            case '"':      sValue.push_back('"');     break;
+            case '\\':     sValue.push_back('\\');    break;
+            case 'b':      sValue.push_back('\b');    break;
+            case 'f':      sValue.push_back('\f');    break;
+            case 'n':      sValue.push_back('\n');    break;
+            case 'r':      sValue.push_back('\r');    break;
+            case 't':      sValue.push_back('\t');    break;
+            case 'u':
+               m_nLexeme = LEXEME_UNICODE;
+               m_nCodeUnit = 0;
+               m_nHexDigits = 0;
+               break;
+            default: {
+               std::string sMessage = std::string("Unrecognized escape sequence found in string: \\") + c;
+               throw Reader::ScanException(sMessage, m_Location);
+            }
+         }
+      }
+      else // LEXEME_UNICODE
+      {
+         char c = *p++;
+         Step(c);
+         if (c >= '0' && c <= '9')        m_nCodeUnit = (m_nCodeUnit << 4) + (c - '0');
+         else if (c >= 'a' && c <= 'f')   m_nCodeUnit = (m_nCodeUnit << 4) + (c - 'a' + 10);
+         else if (c >= 'A' && c <= 'F')   m_nCodeUnit = (m_nCodeUnit << 4) + (c - 'A' + 10);
+         else {
+            std::string sMessage = std::string("Invalid hex digit in unicode escape sequence: ") + c;
+            throw Reader::ScanException(sMessage, m_Location);
+         }
+
+         if (++m_nHexDigits == 4) {
+            EndCodeUnit();
+            m_nLexeme = LEXEME_STRING;
+         }
+      }
+   }
+
+   return p;
+}
+
+
+inline void PushReader::EndCodeUnit()
+{
+   // same rules as Reader: a high surrogate pairs up with an immediately following
+   //  "\u" low surrogate, or else stands alone
+   std::string& sValue = m_String.Value();
+   if (m_nHighSurrogate != 0)
+   {
+      if (m_nCodeUnit < 0xDC00 || m_nCodeUnit > 0xDFFF)
+         throw Reader::ScanException("Invalid UTF-16 surrogate pair found in string", m_Location);
+      Reader::AppendUtf8(0x10000 + ((m_nHighSurrogate - 0xD800) << 10) + (m_nCodeUnit - 0xDC00), sValue);
+      m_nHighSurrogate = 0;
+   }
+   else if (m_nCodeUnit >= 0xD800 && m_nCodeUnit <= 0xDBFF)
+      m_nHighSurrogate = m_nCodeUnit;
+   else
+      Reader::AppendUtf8(m_nCodeUnit, sValue);
+}
+
+
+inline void PushReader::FlushHighSurrogate()
+{
+   if (m_nHighSurrogate != 0) {
+      Reader::AppendUtf8(m_nHighSurrogate, m_String.Value());
+      m_nHighSurrogate = 0;
+   }
+}
+
+
+inline void PushReader::EndString()
+{
+   m_nLexeme = LEXEME_NONE;
+   if (m_bKey == false)
+   {
+      m_pHandler->Value(m_String);
+      EndValue();
+      return;
+   }
+
+   m_pHandler->Key(m_String.Value());
+   m_nState = STATE_COLON;
+}
+
+
+inline const char* PushReader::ScanNumber(const char* p, const char* pEnd)
+{
+   for (; p != pEnd; ++p)
+   {
+      char c = *p;
+      if ((c < '0' || c > '9') &&
+          c != '.' && c != 'e' && c != 'E' && c != '-' && c != '+')
+      {
+         // this character belongs to whatever's next; leave it for the caller
+         EndNumber();
+         break;
+      }
+
+      m_sNumber.push_back(c);
+      Step(c);
+   }
+
+   return p;
+}
+
+
+inline void PushReader::EndNumber()
+{
+   m_nLexeme = LEXEME_NONE;
+
+   const char* pBegin = m_sNumber.data();
+   const char* pEnd = pBegin + m_sNumber.size();
+   double dValue;
+   const char* pError = Reader::ConvertNumber(pBegin, pEnd, dValue);
+   if (pError == pEnd)
+   {
+      std::string sMessage = std::string("Incomplete NUMBER token: ") + m_sNumber;
+      throw Reader::ParseException(sMessage, m_locTokenBegin, m_Location);
+   }
+   else if (pError != 0)
+   {
+      std::string sMessage = std::string("Unexpected character in NUMBER token: ") + *pError;
+      throw Reader::ParseException(sMessage, m_locTokenBegin, m_Location);
+   }
+
+   m_pHandler->Value(Number(dValue));
+   EndValue();
+}
+
+
+inline const char* PushReader::ScanLiteral(const char* p, const char* pEnd)
+{
+   while (p != pEnd)
+   {
+      char c = *p++;
+      Step(c);
+      if (c != m_sLiteral[m_nLiteralLength])
+         throw Reader::ScanException(std::string("Expected string: ") + m_sLiteral, m_Location);
+
+      if (m_sLiteral[++m_nLiteralLength] == '\0')
+      {
+         m_nLexeme = LEXEME_NONE;
+         if (*m_sLiteral == 'n')
+            m_pHandler->Value(Null());
+         else
+            m_pHandler->Value(Boolean(*m_sLiteral == 't'));
+         EndValue();
+         break;
+      }
+   }
+
+   return p;
+}
+
+
+inline void PushReader::Step(char c)
+{
+   ++m_Location.m_nDocOffset;
+   if (c == '\n') {
+      ++m_Location.m_nLine;
+      m_Location.m_nLineOffset = 0;
+   }
+   else
+      ++m_Location.m_nLineOffset;
+}
+
+
+inline void PushReader::ThrowUnexpected(const std::string& sPrefix, char c)
+{
+   // characters that can't start any token are a scanning problem, like in Reader
+   if (c == '\0' || std::strchr("{}[],:\"-0123456789tfn", c) == 0)
+   {
+      std::string sMessage = std::string("Unexpected character in stream: ") + c;
+      throw Reader::ScanException(sMessage, m_locTokenBegin);
+   }
+
+   throw Reader::ParseException(sPrefix + c, m_locTokenBegin, m_Location);
+}
+
+
+} // End namespace
@@ -31,8 +31,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include "document.h"
 #include "elements.h"
+#include "scanner.h"
+#include "visitor.h"
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace json
@@ -40,18 +44,22 @@ namespace json
 
 class Reader
 {
+   friend class ParallelReader;
+   friend class PushReader;
+   friend class RecordReader;
+
 public:
    // this structure will be reported in one of the exceptions defined below
    struct Location
    {
       Location();
 
-      unsigned int m_nLine;       // document line, zero-indexed
-      unsigned int m_nLineOffset; // character offset from beginning of line, zero indexed
-      unsigned int m_nDocOffset;  // character offset from entire document, zero indexed
+      size_t m_nLine;         // document line, zero-indexed
+      size_t m_nLineOffset;   // character offset from beginning of line, zero indexed
+      size_t m_nDocOffset;    // character offset from entire document, zero indexed
    };
 
-   // thrown during the first phase of reading. generally catches low-level problems such
+   // thrown while scanning characters. generally catches low-level problems such
    //  as errant characters or corrupt/incomplete documents
    class ScanException : public Exception
    {
@@ -63,7 +71,7 @@ public:
       Reader::Location m_locError;
    };
 
-   // thrown during the second phase of reading. generally catches higher-level problems such
+   // thrown while parsing tokens. generally catches higher-level problems such
    //  as missing commas or brackets
    class ParseException : public Exception
    {
@@ -89,56 +97,151 @@ public:
    // ...otherwise, if you don't know, call this & visit it
    static void Read(UnknownElement& elementRoot, std::istream& istr);
 
+   // same as above, but for documents already held in memory. the buffer is scanned 
+   //  in place, which is much faster than going through a stream
+   static void Read(Object& object, const char* pData, size_t nLength);
+   static void Read(Array& array, const char* pData, size_t nLength);
+   static void Read(String& string, const char* pData, size_t nLength);
+   static void Read(Number& number, const char* pData, size_t nLength);
+   static void Read(Boolean& boolean, const char* pData, size_t nLength);
+   static void Read(Null& null, const char* pData, size_t nLength);
+   static void Read(UnknownElement& elementRoot, const char* pData, size_t nLength);
+
+   static void Read(Object& object, const std::string& sDocument);
+   static void Read(Array& array, const std::string& sDocument);
+   static void Read(String& string, const std::string& sDocument);
+   static void Read(Number& number, const std::string& sDocument);
+   static void Read(Boolean& boolean, const std::string& sDocument);
+   static void Read(Null& null, const std::string& sDocument);
+   static void Read(UnknownElement& elementRoot, const std::string& sDocument);
+
+   // reads into a Document, which allocates the whole tree from its own arena. any
+   //  previous contents are discarded
+   static void Read(Document& document, std::istream& istr);
+   static void Read(Document& document, const char* pData, size_t nLength);
+   static void Read(Document& document, const std::string& sDocument);
+
+   // or, skip building elements altogether & have the document's contents pushed to a
+   //  handler as they are read. memory use stays constant no matter the document size
+   static void Read(Handler& handler, std::istream& istr);
+   static void Read(Handler& handler, const char* pData, size_t nLength);
+   static void Read(Handler& handler, const std::string& sDocument);
+
+   // reads a document straight from disk. regular files are memory mapped where the
+   //  platform allows it; anything else (pipes, devices...) is read through a stream
+   static void ReadFile(Object& object, const char* sPath);
+   static void ReadFile(Array& array, const char* sPath);
+   static void ReadFile(String& string, const char* sPath);
+   static void ReadFile(Number& number, const char* sPath);
+   static void ReadFile(Boolean& boolean, const char* sPath);
+   static void ReadFile(Null& null, const char* sPath);
+   static void ReadFile(UnknownElement& elementRoot, const char* sPath);
+   static void ReadFile(Document& document, const char* sPath);
+   static void ReadFile(Handler& handler, const char* sPath);
+
 private:
-   struct Token
-   {
-      enum Type
-      {
-         TOKEN_OBJECT_BEGIN,  //    {
-         TOKEN_OBJECT_END,    //    }
-         TOKEN_ARRAY_BEGIN,   //    [
-         TOKEN_ARRAY_END,     //    ]
-         TOKEN_NEXT_ELEMENT,  //    ,
-         TOKEN_MEMBER_ASSIGN, //    :
-         TOKEN_STRING,        //    "xxx"
-         TOKEN_NUMBER,        //    [+/-]000.000[e[+/-]000]
-         TOKEN_BOOLEAN,       //    true -or- false
-         TOKEN_NULL,          //    null
-      };
-
-      Type nType;
-      std::string sValue;
-
-      // for malformed file debugging
-      Reader::Location locBegin;
-      Reader::Location locEnd;
-   };
+   Reader();
 
    class InputStream;
-   class TokenStream;
-   typedef std::vector<Token> Tokens;
+   class MappedFile;
 
+   // pNames: where to intern member names, if anywhere
    template <typename ElementTypeT>   
-   static void Read_i(ElementTypeT& element, std::istream& istr);
+   static void Read_i(ElementTypeT& element, InputStream& inputStream, NameTable* pNames = 0);
 
-   // scanning istream into token sequence
-   void Scan(Tokens& tokens, InputStream& inputStream);
+   template <typename ElementTypeT>   
+   static void ReadFile_i(ElementTypeT& element, const char* sPath);
 
+   // scanning low-level lexical elements straight off the input stream
    void EatWhiteSpace(InputStream& inputStream);
-   std::string MatchString(InputStream& inputStream);
-   std::string MatchNumber(InputStream& inputStream);
+   void MatchString(InputStream& inputStream, std::string& string);
+   void MatchUnicodeEscape(InputStream& inputStream, std::string& string);
+   unsigned int MatchHexQuad(InputStream& inputStream);
+   void MatchNumber(InputStream& inputStream, std::string& sNumber);
    std::string MatchExpectedString(InputStream& inputStream, const std::string& sExpected);
+   std::string MatchToken(InputStream& inputStream);
+
+   // parsing input stream into element structure, one token at a time
+   void Parse(UnknownElement& element, InputStream& inputStream);
+   void Parse(Object& object, InputStream& inputStream);
+   void Parse(Array& array, InputStream& inputStream);
+   void Parse(String& string, InputStream& inputStream);
+   void Parse(Number& number, InputStream& inputStream);
+   void Parse(Boolean& boolean, InputStream& inputStream);
+   void Parse(Null& null, InputStream& inputStream);
+   void Parse(Document& document, InputStream& inputStream);
+   void Parse(Handler& handler, InputStream& inputStream);
+
+   void MatchExpectedToken(char cExpected, InputStream& inputStream);
+   void ThrowUnexpectedToken(const std::string& sPrefix, InputStream& inputStream);
+
+   // converting number tokens to doubles, without going through a stream
+   static bool IsNumberStart(char c);
+   static const char* ConvertNumber(const char* pBegin, const char* pEnd, double& dValue);
+
+   static void AppendUtf8(unsigned int nCodePoint, std::string& string);
+
+   // interns m_sKey in m_pNames, by way of a small cache of the names interned 
+   //  lately. records mostly repeat the same few keys, so a thread-safe table 
+   //  (shared by ParallelReader's threads, say) is rarely locked
+   Name InternKey();
+   enum { NAME_CACHE_SIZE = 64 };
+
+   // where new elements are allocated; 0 for the heap
+   Arena* m_pArena;
+
+   // where member names are interned, if anywhere (a Document's table, or one
+   //  given to a RecordReader, PushReader or ParallelReader)
+   NameTable* m_pNames;
+   std::vector<Name> m_NameCache;   // by hash; empty until the first name
+
+   // scratch buffers, reused for every token
+   std::string m_sNumber;
+   std::string m_sKey;
+   String m_String;
+};
 
-   // parsing token sequence into element structure
-   void Parse(UnknownElement& element, TokenStream& tokenStream);
-   void Parse(Object& object, TokenStream& tokenStream);
-   void Parse(Array& array, TokenStream& tokenStream);
-   void Parse(String& string, TokenStream& tokenStream);
-   void Parse(Number& number, TokenStream& tokenStream);
-   void Parse(Boolean& boolean, TokenStream& tokenStream);
-   void Parse(Null& null, TokenStream& tokenStream);
 
-   const std::string& MatchExpectedToken(Token::Type nExpected, TokenStream& tokenStream);
+/////////////////////////////////////////////////////////////////////////
+// RecordReader - reads a stream of documents one after another, such as 
+//  newline-delimited JSON (one record per line) or simply concatenated JSON.
+//  Records may be separated by any amount of white space, or none at all. The 
+//  input buffer & scratch space are kept from one record to the next, and 
+//  Locations count from the start of the whole stream.
+//
+//  RecordReader recordReader(istr);
+//  UnknownElement elemRecord;
+//  while (recordReader.Read(elemRecord))
+//     ...
+//
+// Once a Read() throws, the stream position is unspecified.
+
+class RecordReader
+{
+public:
+   RecordReader(std::istream& istr);
+
+   // contiguous input must outlive the RecordReader
+   RecordReader(const char* pData, size_t nLength);
+
+   // same, but interning member names in a table (see NameTable), which records 
+   //  with the same keys then share
+   RecordReader(std::istream& istr, NameTable& names);
+   RecordReader(const char* pData, size_t nLength, NameTable& names);
+
+   ~RecordReader();
+
+   // reads the next record, replacing element's old contents. returns false 
+   //  when there are no records left
+   bool Read(UnknownElement& element);
+   bool Read(Handler& handler);
+
+private:
+   RecordReader(const RecordReader&);               // not copyable
+   RecordReader& operator = (const RecordReader&);
+
+   Reader m_Reader;
+   Reader::InputStream* m_pInputStream;
 };
 
 
@@ -27,15 +27,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 ******************************************************************************/
 
+#include <algorithm>
 #include <cassert>
-#include <set>
-#include <sstream>
+#include <clocale>
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 /*  
 
 TODO:
 * better documentation
-* unicode character decoding
 
 */
 
@@ -47,6 +56,12 @@ inline std::istream& operator >> (std::istream& istr, UnknownElement& elementRoo
    return istr;
 }
 
+inline Reader::Reader() :
+   m_pArena(0),
+   m_pNames(0)
+{}
+
+
 inline Reader::Location::Location() :
    m_nLine(0),
    m_nLineOffset(0),
@@ -57,225 +72,339 @@ inline Reader::Location::Location() :
 //////////////////////
 // Reader::InputStream
 
-class Reader::InputStream // would be cool if we could inherit from std::istream & override "get"
+class Reader::InputStream
 {
 public:
-   InputStream(std::istream& iStr) :
-      m_iStr(iStr) {}
+   // stream input is pulled into an internal buffer a block at a time...
+   InputStream(std::istream& iStr);
+
+   // ...while contiguous input is scanned in place. it must outlive the InputStream
+   InputStream(const char* pBegin, const char* pEnd);
+
+   // protect access to the input, so we can keeep track of document/line offsets
+   char Get() {
+      assert(m_pCur != m_pEnd); // enforce reading of only valid stream data 
+      char c = *m_pCur++;
+      if (c == '\n') {
+         ++m_nLine;
+         m_nLineBegin = DocOffset();
+      }
+      return c;
+   }
 
-   // protect access to the input stream, so we can keeep track of document/line offsets
-   char Get(); // big, define outside
-   char Peek() {
-      assert(m_iStr.eof() == false); // enforce reading of only valid stream data 
-      return m_iStr.peek();
+   char Peek() const {
+      assert(m_pCur != m_pEnd); // enforce reading of only valid stream data 
+      return *m_pCur;
    }
 
    bool EOS() {
-      m_iStr.peek(); // apparently eof flag isn't set until a character read is attempted. whatever.
-      return m_iStr.eof();
+      return m_pCur == m_pEnd && 
+             Refill() == false;
    }
 
-   const Location& GetLocation() const { return m_Location; }
-
-private:
-   std::istream& m_iStr;
-   Location m_Location;
-};
+   // true if the next two characters are c0 & c1. may refill, carrying the unread tail over
+   bool Peek(char c0, char c1) {
+      if (m_pEnd - m_pCur < 2)
+         Refill();
+      return m_pEnd - m_pCur >= 2 &&
+             m_pCur[0] == c0 && m_pCur[1] == c1;
+   }
 
+   // direct access to the buffered input, for scanning runs of characters in bulk. 
+   //  Skip() moves past a run; any newlines in it must be reported
+   const char* Current() const { return m_pCur; }
+   const char* End() const { return m_pEnd; }
 
-inline char Reader::InputStream::Get()
-{
-   assert(m_iStr.eof() == false); // enforce reading of only valid stream data 
-   char c = m_iStr.get();
-   
-   ++m_Location.m_nDocOffset;
-   if (c == '\n') {
-      ++m_Location.m_nLine;
-      m_Location.m_nLineOffset = 0;
-   }
-   else {
-      ++m_Location.m_nLineOffset;
+   void Skip(const char* pNext) {
+      assert(pNext >= m_pCur && pNext <= m_pEnd);
+      m_pCur = pNext;
    }
 
-   return c;
-}
-
+   void Skip(const char* pNext, size_t nLines, const char* pLastNewLine) {
+      Skip(pNext);
+      if (nLines != 0) {
+         m_nLine += nLines;
+         m_nLineBegin = m_nBlockOffset + (pLastNewLine + 1 - m_pBegin);
+      }
+   }
 
+   Location GetLocation() const;
 
-//////////////////////
-// Reader::TokenStream
+private:
+   enum { BLOCK_SIZE = 64 * 1024 };
 
-class Reader::TokenStream
-{
-public:
-   TokenStream(const Tokens& tokens);
+   bool Refill(); // big, define outside
+   size_t DocOffset() const { return m_nBlockOffset + (m_pCur - m_pBegin); }
 
-   const Token& Peek();
-   const Token& Get();
+   std::istream* m_pIStr;        // null when reading contiguous input
+   std::vector<char> m_Block;
 
-   bool EOS() const;
+   const char* m_pBegin;
+   const char* m_pCur;
+   const char* m_pEnd;
 
-private:
-   const Tokens& m_Tokens;
-   Tokens::const_iterator m_itCurrent;
+   size_t m_nBlockOffset;        // document offset of m_pBegin
+   size_t m_nLine;
+   size_t m_nLineBegin;          // document offset of the current line's first character
 };
 
 
-inline Reader::TokenStream::TokenStream(const Tokens& tokens) :
-   m_Tokens(tokens),
-   m_itCurrent(tokens.begin())
+inline Reader::InputStream::InputStream(std::istream& iStr) :
+   m_pIStr(&iStr),
+   m_pBegin(0),
+   m_pCur(0),
+   m_pEnd(0),
+   m_nBlockOffset(0),
+   m_nLine(0),
+   m_nLineBegin(0)
+{}
+
+inline Reader::InputStream::InputStream(const char* pBegin, const char* pEnd) :
+   m_pIStr(0),
+   m_pBegin(pBegin),
+   m_pCur(pBegin),
+   m_pEnd(pEnd),
+   m_nBlockOffset(0),
+   m_nLine(0),
+   m_nLineBegin(0)
 {}
 
-inline const Reader::Token& Reader::TokenStream::Peek() {
-   if (EOS())
+inline bool Reader::InputStream::Refill()
+{
+   if (m_pIStr == 0)
+      return false;
+
+   // any unread characters (only ever a lookahead's worth) move to the front of the block
+   size_t nKeep = m_pEnd - m_pCur;
+   size_t nKeepFrom = m_pCur - m_pBegin;
+   m_nBlockOffset += nKeepFrom;
+   m_Block.resize(BLOCK_SIZE);
+   std::copy(m_Block.begin() + nKeepFrom, m_Block.begin() + nKeepFrom + nKeep, m_Block.begin());
+
+   // straight from the stream buffer: istream::read sets failbit on a short block,
+   //  but reaching the end of the input should only set eofbit, as peeking at it would
+   std::streamsize nRead = 0;
+   if (m_pIStr->fail() || m_pIStr->rdbuf() == 0)
+      m_pIStr->setstate(std::ios::failbit);
+   else
    {
-      const Token& lastToken = *m_Tokens.rbegin();
-      std::string sMessage = "Unexpected end of token stream";
-      throw ParseException(sMessage, lastToken.locBegin, lastToken.locEnd); // nowhere to point to
+      nRead = m_pIStr->rdbuf()->sgetn(&m_Block[nKeep], BLOCK_SIZE - nKeep);
+      if (nRead < static_cast<std::streamsize>(BLOCK_SIZE - nKeep))
+         m_pIStr->setstate(std::ios::eofbit);
    }
-   return *(m_itCurrent); 
-}
 
-inline const Reader::Token& Reader::TokenStream::Get() {
-   const Token& token = Peek();
-   ++m_itCurrent;
-   return token;
+   m_pBegin = m_pCur = &m_Block[0];
+   m_pEnd = m_pBegin + nKeep + nRead;
+   return m_pCur != m_pEnd;
 }
 
-inline bool Reader::TokenStream::EOS() const {
-   return m_itCurrent == m_Tokens.end(); 
+inline Reader::Location Reader::InputStream::GetLocation() const
+{
+   Location location;
+   location.m_nLine = m_nLine;
+   location.m_nLineOffset = DocOffset() - m_nLineBegin;
+   location.m_nDocOffset = DocOffset();
+   return location;
 }
 
-///////////////////
-// Reader (finally)
-
 
-inline void Reader::Read(Object& object, std::istream& istr)                { Read_i(object, istr); }
-inline void Reader::Read(Array& array, std::istream& istr)                  { Read_i(array, istr); }
-inline void Reader::Read(String& string, std::istream& istr)                { Read_i(string, istr); }
-inline void Reader::Read(Number& number, std::istream& istr)                { Read_i(number, istr); }
-inline void Reader::Read(Boolean& boolean, std::istream& istr)              { Read_i(boolean, istr); }
-inline void Reader::Read(Null& null, std::istream& istr)                    { Read_i(null, istr); }
-inline void Reader::Read(UnknownElement& unknown, std::istream& istr)       { Read_i(unknown, istr); }
 
+/////////////////////
+// Reader::MappedFile
 
-template <typename ElementTypeT>   
-void Reader::Read_i(ElementTypeT& element, std::istream& istr)
+class Reader::MappedFile
 {
-   Reader reader;
+public:
+   // maps the whole file read-only if it's a regular file. anything else is left
+   //  unmapped, and up to the caller to read some other way
+   MappedFile(const char* sPath);
+   ~MappedFile();
+
+   bool IsMapped() const { return m_bMapped; }
+   const char* Begin() const { return m_pData; }
+   const char* End() const { return m_pData + m_nSize; }
 
-   Tokens tokens;
-   InputStream inputStream(istr);
-   reader.Scan(tokens, inputStream);
+private:
+   MappedFile(const MappedFile&);               // not copyable
+   MappedFile& operator = (const MappedFile&);
+
+   bool m_bMapped;
+   const char* m_pData;
+   size_t m_nSize;
+};
 
-   TokenStream tokenStream(tokens);
-   reader.Parse(element, tokenStream);
 
-   if (tokenStream.EOS() == false)
+#ifdef JSON_MMAP
+
+inline Reader::MappedFile::MappedFile(const char* sPath) :
+   m_bMapped(false),
+   m_pData(0),
+   m_nSize(0)
+{
+   // only regular files get opened here at all: opening a FIFO or a device can 
+   //  block or consume input, and the caller is about to open it again anyway
+   struct stat fileStat;
+   if (::stat(sPath, &fileStat) != 0 ||
+       S_ISREG(fileStat.st_mode) == false)
+      return;
+
+   int nFile = ::open(sPath, O_RDONLY);
+   if (nFile < 0)
+      return;
+
+   // (re-checked, in case the path was swapped out in between)
+   if (::fstat(nFile, &fileStat) == 0 && 
+       S_ISREG(fileStat.st_mode))
    {
-      const Token& token = tokenStream.Peek();
-      std::string sMessage = std::string("Expected End of token stream; found ") + token.sValue;
-      throw ParseException(sMessage, token.locBegin, token.locEnd);
+      m_nSize = static_cast<size_t>(fileStat.st_size);
+      if (m_nSize == 0)
+         m_bMapped = true; // nothing to map, but nothing to read either
+      else
+      {
+         void* pData = ::mmap(0, m_nSize, PROT_READ, MAP_PRIVATE, nFile, 0);
+         if (pData != MAP_FAILED)
+         {
+            // we're going to read it front to back, exactly once
+            ::madvise(pData, m_nSize, MADV_SEQUENTIAL);
+            m_pData = static_cast<const char*>(pData);
+            m_bMapped = true;
+         }
+         else
+            m_nSize = 0;
+      }
    }
-}
 
+   ::close(nFile); // the mapping holds its own reference
+}
 
-inline void Reader::Scan(Tokens& tokens, InputStream& inputStream)
+inline Reader::MappedFile::~MappedFile()
 {
-   while (EatWhiteSpace(inputStream),              // ignore any leading white space...
-          inputStream.EOS() == false) // ...before checking for EOS
-   {
-      // if all goes well, we'll create a token each pass
-      Token token;
-      token.locBegin = inputStream.GetLocation();
+   if (m_pData)
+      ::munmap(const_cast<char*>(m_pData), m_nSize);
+}
 
-      // gives us null-terminated string
-      char sChar = inputStream.Peek();
-      switch (sChar)
-      {
-         case '{':
-            token.sValue = MatchExpectedString(inputStream, "{");
-            token.nType = Token::TOKEN_OBJECT_BEGIN;
-            break;
+#else
 
-         case '}':
-            token.sValue = MatchExpectedString(inputStream, "}");
-            token.nType = Token::TOKEN_OBJECT_END;
-            break;
+inline Reader::MappedFile::MappedFile(const char*) :
+   m_bMapped(false),
+   m_pData(0),
+   m_nSize(0)
+{}
 
-         case '[':
-            token.sValue = MatchExpectedString(inputStream, "[");
-            token.nType = Token::TOKEN_ARRAY_BEGIN;
-            break;
+inline Reader::MappedFile::~MappedFile() {}
 
-         case ']':
-            token.sValue = MatchExpectedString(inputStream, "]");
-            token.nType = Token::TOKEN_ARRAY_END;
-            break;
+#endif // JSON_MMAP
 
-         case ',':
-            token.sValue = MatchExpectedString(inputStream, ",");
-            token.nType = Token::TOKEN_NEXT_ELEMENT;
-            break;
 
-         case ':':
-            token.sValue = MatchExpectedString(inputStream, ":");
-            token.nType = Token::TOKEN_MEMBER_ASSIGN;
-            break;
 
-         case '"':
-            token.sValue = MatchString(inputStream);
-            token.nType = Token::TOKEN_STRING;
-            break;
+///////////////////
+// Reader (finally)
 
-         case '-':
-         case '0':
-         case '1':
-         case '2':
-         case '3':
-         case '4':
-         case '5':
-         case '6':
-         case '7':
-         case '8':
-         case '9':
-            token.sValue = MatchNumber(inputStream);
-            token.nType = Token::TOKEN_NUMBER;
-            break;
 
-         case 't':
-            token.sValue = MatchExpectedString(inputStream, "true");
-            token.nType = Token::TOKEN_BOOLEAN;
-            break;
+inline void Reader::Read(Object& object, std::istream& istr)                { InputStream inputStream(istr); Read_i(object, inputStream); }
+inline void Reader::Read(Array& array, std::istream& istr)                  { InputStream inputStream(istr); Read_i(array, inputStream); }
+inline void Reader::Read(String& string, std::istream& istr)                { InputStream inputStream(istr); Read_i(string, inputStream); }
+inline void Reader::Read(Number& number, std::istream& istr)                { InputStream inputStream(istr); Read_i(number, inputStream); }
+inline void Reader::Read(Boolean& boolean, std::istream& istr)              { InputStream inputStream(istr); Read_i(boolean, inputStream); }
+inline void Reader::Read(Null& null, std::istream& istr)                    { InputStream inputStream(istr); Read_i(null, inputStream); }
+inline void Reader::Read(UnknownElement& unknown, std::istream& istr)       { InputStream inputStream(istr); Read_i(unknown, inputStream); }
+
+inline void Reader::Read(Object& object, const char* pData, size_t nLength)            { InputStream inputStream(pData, pData + nLength); Read_i(object, inputStream); }
+inline void Reader::Read(Array& array, const char* pData, size_t nLength)              { InputStream inputStream(pData, pData + nLength); Read_i(array, inputStream); }
+inline void Reader::Read(String& string, const char* pData, size_t nLength)            { InputStream inputStream(pData, pData + nLength); Read_i(string, inputStream); }
+inline void Reader::Read(Number& number, const char* pData, size_t nLength)            { InputStream inputStream(pData, pData + nLength); Read_i(number, inputStream); }
+inline void Reader::Read(Boolean& boolean, const char* pData, size_t nLength)          { InputStream inputStream(pData, pData + nLength); Read_i(boolean, inputStream); }
+inline void Reader::Read(Null& null, const char* pData, size_t nLength)                { InputStream inputStream(pData, pData + nLength); Read_i(null, inputStream); }
+inline void Reader::Read(UnknownElement& unknown, const char* pData, size_t nLength)   { InputStream inputStream(pData, pData + nLength); Read_i(unknown, inputStream); }
+
+inline void Reader::Read(Object& object, const std::string& sDocument)                 { Read(object, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(Array& array, const std::string& sDocument)                   { Read(array, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(String& string, const std::string& sDocument)                 { Read(string, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(Number& number, const std::string& sDocument)                 { Read(number, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(Boolean& boolean, const std::string& sDocument)               { Read(boolean, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(Null& null, const std::string& sDocument)                     { Read(null, sDocument.data(), sDocument.size()); }
+inline void Reader::Read(UnknownElement& unknown, const std::string& sDocument)        { Read(unknown, sDocument.data(), sDocument.size()); }
+
+inline void Reader::Read(Document& document, std::istream& istr)                        { InputStream inputStream(istr); Read_i(document, inputStream); }
+inline void Reader::Read(Document& document, const char* pData, size_t nLength)         { InputStream inputStream(pData, pData + nLength); Read_i(document, inputStream); }
+inline void Reader::Read(Document& document, const std::string& sDocument)              { Read(document, sDocument.data(), sDocument.size()); }
+
+inline void Reader::Read(Handler& handler, std::istream& istr)                         { InputStream inputStream(istr); Read_i(handler, inputStream); }
+inline void Reader::Read(Handler& handler, const char* pData, size_t nLength)          { InputStream inputStream(pData, pData + nLength); Read_i(handler, inputStream); }
+inline void Reader::Read(Handler& handler, const std::string& sDocument)               { Read(handler, sDocument.data(), sDocument.size()); }
+
+
+inline void Reader::ReadFile(Object& object, const char* sPath)            { ReadFile_i(object, sPath); }
+inline void Reader::ReadFile(Array& array, const char* sPath)              { ReadFile_i(array, sPath); }
+inline void Reader::ReadFile(String& string, const char* sPath)            { ReadFile_i(string, sPath); }
+inline void Reader::ReadFile(Number& number, const char* sPath)            { ReadFile_i(number, sPath); }
+inline void Reader::ReadFile(Boolean& boolean, const char* sPath)          { ReadFile_i(boolean, sPath); }
+inline void Reader::ReadFile(Null& null, const char* sPath)                { ReadFile_i(null, sPath); }
+inline void Reader::ReadFile(UnknownElement& unknown, const char* sPath)   { ReadFile_i(unknown, sPath); }
+inline void Reader::ReadFile(Document& document, const char* sPath)        { ReadFile_i(document, sPath); }
+inline void Reader::ReadFile(Handler& handler, const char* sPath)          { ReadFile_i(handler, sPath); }
 
-         case 'f':
-            token.sValue = MatchExpectedString(inputStream, "false");
-            token.nType = Token::TOKEN_BOOLEAN;
-            break;
 
-         case 'n':
-            token.sValue = MatchExpectedString(inputStream, "null");
-            token.nType = Token::TOKEN_NULL;
-            break;
+template <typename ElementTypeT>   
+void Reader::Read_i(ElementTypeT& element, InputStream& inputStream, NameTable* pNames)
+{
+   Reader reader;
+   reader.m_pNames = pNames;
+   reader.Parse(element, inputStream);
+
+   // nothing but white space allowed after the root element
+   reader.EatWhiteSpace(inputStream);
+   if (inputStream.EOS() == false)
+      reader.ThrowUnexpectedToken("Expected End of token stream; found ", inputStream);
+}
 
-         default:
-         {
-            std::string sErrorMessage = std::string("Unexpected character in stream: ") + sChar;
-            throw ScanException(sErrorMessage, inputStream.GetLocation());
-         }
-      }
 
-      token.locEnd = inputStream.GetLocation();
-      tokens.push_back(token);
+template <typename ElementTypeT>   
+void Reader::ReadFile_i(ElementTypeT& element, const char* sPath)
+{
+   MappedFile mappedFile(sPath);
+   if (mappedFile.IsMapped())
+   {
+      InputStream inputStream(mappedFile.Begin(), mappedFile.End());
+      Read_i(element, inputStream);
    }
+   else
+   {
+      std::ifstream ifStr(sPath, std::ios::in | std::ios::binary);
+      if (ifStr.is_open() == false)
+         throw Exception(std::string("Unable to open file: ") + sPath);
+
+      InputStream inputStream(ifStr);
+      Read_i(element, inputStream);
+   }
+}
+
+
+inline Name Reader::InternKey()
+{
+   if (m_NameCache.empty())
+      m_NameCache.resize(NAME_CACHE_SIZE);
+
+   size_t nHash = Name::Hash(m_sKey.data(), m_sKey.size());
+   Name& nameCached = m_NameCache[nHash % NAME_CACHE_SIZE];
+   if (nameCached.Hash() != nHash || nameCached != m_sKey)
+      nameCached = m_pNames->Intern(m_sKey);
+   return nameCached;
 }
 
 
 inline void Reader::EatWhiteSpace(InputStream& inputStream)
 {
+   // skips the whole run of buffered white space at once. we only come back 
+   //  around if the run reached the end of the buffer
    while (inputStream.EOS() == false && 
-          ::isspace(inputStream.Peek()))
-      inputStream.Get();
+          Scanner::IsWhiteSpace(inputStream.Peek()))
+   {
+      size_t nLines = 0;
+      const char* pLastNewLine = 0;
+      const char* pNext = Scanner::SkipWhiteSpace(inputStream.Current(), inputStream.End(), nLines, pLastNewLine);
+      inputStream.Skip(pNext, nLines, pLastNewLine);
+   }
 }
 
 inline std::string Reader::MatchExpectedString(InputStream& inputStream, const std::string& sExpected)
@@ -296,14 +425,24 @@ inline std::string Reader::MatchExpectedString(InputStream& inputStream, const s
 }
 
 
-inline std::string Reader::MatchString(InputStream& inputStream)
+inline void Reader::MatchString(InputStream& inputStream, std::string& string)
 {
    MatchExpectedString(inputStream, "\"");
 
-   std::string string;
    while (inputStream.EOS() == false &&
           inputStream.Peek() != '"')
    {
+      // plain characters are copied over in bulk, up to whatever needs a closer look...
+      const char* pRun = inputStream.Current();
+      const char* pRunEnd = Scanner::FindStringSpecial(pRun, inputStream.End());
+      if (pRunEnd != pRun)
+      {
+         string.append(pRun, pRunEnd);
+         inputStream.Skip(pRunEnd);
+         continue;
+      }
+
+      // ...which is an escape sequence or a control character
       char c = inputStream.Get();
 
       // escape?
@@ -320,7 +459,7 @@ inline std::string Reader::MatchString(InputStream& inputStream)
             case 'n':      string.push_back('\n');    break;
             case 'r':      string.push_back('\r');    break;
             case 't':      string.push_back('\t');    break;
-            case 'u':      string.push_back('\u');    break; // TODO: what do we do with this?
+            case 'u':      MatchUnicodeEscape(inputStream, string);   break;
             default: {
                std::string sMessage = std::string("Unrecognized escape sequence found in string: \\") + c;
                throw ScanException(sMessage, inputStream.GetLocation());
@@ -334,200 +473,703 @@ inline std::string Reader::MatchString(InputStream& inputStream)
 
    // eat the last '"' that we just peeked
    MatchExpectedString(inputStream, "\"");
+}
 
-   // all's well if we made it here
-   return string;
+
+inline void Reader::MatchUnicodeEscape(InputStream& inputStream, std::string& string)
+{
+   // "\u" has already been eaten. decode the UTF-16 code unit, and its trailing
+   //  low surrogate if it has one, & append the code point as UTF-8. a high surrogate
+   //  followed by anything but another "\u" is lone, & any other escape is left be
+   unsigned int nCodePoint = MatchHexQuad(inputStream);
+   if (nCodePoint >= 0xD800 && nCodePoint <= 0xDBFF &&
+       inputStream.Peek('\\', 'u'))
+   {
+      MatchExpectedString(inputStream, "\\u");
+      unsigned int nLow = MatchHexQuad(inputStream);
+      if (nLow < 0xDC00 || nLow > 0xDFFF)
+         throw ScanException("Invalid UTF-16 surrogate pair found in string", inputStream.GetLocation());
+      nCodePoint = 0x10000 + ((nCodePoint - 0xD800) << 10) + (nLow - 0xDC00);
+   }
+
+   AppendUtf8(nCodePoint, string);
 }
 
 
-inline std::string Reader::MatchNumber(InputStream& inputStream)
+inline void Reader::AppendUtf8(unsigned int nCodePoint, std::string& string)
 {
-   const char sNumericChars[] = "0123456789.eE-+";
-   std::set<char> numericChars;
-   numericChars.insert(sNumericChars, sNumericChars + sizeof(sNumericChars));
+   if (nCodePoint < 0x80)
+      string.push_back(static_cast<char>(nCodePoint));
+   else if (nCodePoint < 0x800) {
+      string.push_back(static_cast<char>(0xC0 | (nCodePoint >> 6)));
+      string.push_back(static_cast<char>(0x80 | (nCodePoint & 0x3F)));
+   }
+   else if (nCodePoint < 0x10000) {
+      string.push_back(static_cast<char>(0xE0 | (nCodePoint >> 12)));
+      string.push_back(static_cast<char>(0x80 | ((nCodePoint >> 6) & 0x3F)));
+      string.push_back(static_cast<char>(0x80 | (nCodePoint & 0x3F)));
+   }
+   else {
+      string.push_back(static_cast<char>(0xF0 | (nCodePoint >> 18)));
+      string.push_back(static_cast<char>(0x80 | ((nCodePoint >> 12) & 0x3F)));
+      string.push_back(static_cast<char>(0x80 | ((nCodePoint >> 6) & 0x3F)));
+      string.push_back(static_cast<char>(0x80 | (nCodePoint & 0x3F)));
+   }
+}
 
-   std::string sNumber;
-   while (inputStream.EOS() == false &&
-          numericChars.find(inputStream.Peek()) != numericChars.end())
+
+inline unsigned int Reader::MatchHexQuad(InputStream& inputStream)
+{
+   unsigned int nValue = 0;
+   for (int i = 0; i < 4; ++i)
    {
+      char c = (inputStream.EOS() ? '\0' : inputStream.Get());
+      if (c >= '0' && c <= '9')        nValue = (nValue << 4) + (c - '0');
+      else if (c >= 'a' && c <= 'f')   nValue = (nValue << 4) + (c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')   nValue = (nValue << 4) + (c - 'A' + 10);
+      else {
+         std::string sMessage = std::string("Invalid hex digit in unicode escape sequence: ") + c;
+         throw ScanException(sMessage, inputStream.GetLocation());
+      }
+   }
+   return nValue;
+}
+
+
+inline void Reader::MatchNumber(InputStream& inputStream, std::string& sNumber)
+{
+   // grab everything that could belong to a number. the grammar is checked 
+   //  during conversion
+   while (inputStream.EOS() == false)
+   {
+      char c = inputStream.Peek();
+      if ((c < '0' || c > '9') &&
+          c != '.' && c != 'e' && c != 'E' && c != '-' && c != '+')
+         break;
       sNumber.push_back(inputStream.Get());   
    }
+}
+
+
+inline bool Reader::IsNumberStart(char c)
+{
+   // not ::isdigit, which is undefined for the negative chars UTF-8 text produces
+   return c == '-' || (c >= '0' && c <= '9');
+}
+
+inline const char* Reader::ConvertNumber(const char* pBegin, const char* pEnd, double& dValue)
+{
+   // validates the JSON number grammar while accumulating up to 19 significant 
+   //  decimal digits & a decimal exponent. returns the first character that doesn't
+   //  fit the grammar, pEnd if the token stopped short (i.e. "1." or "-"), or 0 
+   //  if everything checked out
+   const char* p = pBegin;
+   bool bNegative = (p != pEnd && *p == '-');
+   if (bNegative)
+      ++p;
+
+   unsigned long long nMantissa = 0;
+   int nDigits = 0;              // significant digits in nMantissa
+   int nExponent = 0;
+   bool bTruncated = false;      // significant digits beyond the 19 we kept
+
+   if (p == pEnd)
+      return pEnd;
+   if (*p == '0')
+      ++p;
+   else if (*p >= '1' && *p <= '9')
+   {
+      for (; p != pEnd && *p >= '0' && *p <= '9'; ++p)
+      {
+         if (nDigits < 19) {
+            nMantissa = nMantissa * 10 + (*p - '0');
+            ++nDigits;
+         }
+         else {
+            ++nExponent;
+            bTruncated |= (*p != '0');
+         }
+      }
+   }
+   else
+      return p;
+
+   if (p != pEnd && *p == '.')
+   {
+      ++p;
+      if (p == pEnd || *p < '0' || *p > '9')
+         return p;
+      for (; p != pEnd && *p >= '0' && *p <= '9'; ++p)
+      {
+         if (nDigits < 19) {
+            nMantissa = nMantissa * 10 + (*p - '0');
+            nDigits += (nMantissa != 0); // leading zeros aren't significant
+            --nExponent;
+         }
+         else
+            bTruncated |= (*p != '0');
+      }
+   }
+
+   if (p != pEnd && (*p == 'e' || *p == 'E'))
+   {
+      ++p;
+      bool bNegativeExponent = (p != pEnd && *p == '-');
+      if (p != pEnd && (*p == '-' || *p == '+'))
+         ++p;
+      if (p == pEnd || *p < '0' || *p > '9')
+         return p;
+
+      int nExplicit = 0;
+      for (; p != pEnd && *p >= '0' && *p <= '9'; ++p)
+      {
+         if (nExplicit < 100000) // way past the range of a double either way
+            nExplicit = nExplicit * 10 + (*p - '0');
+      }
+      nExponent += (bNegativeExponent ? -nExplicit : nExplicit);
+   }
+
+   if (p != pEnd)
+      return p;
+
+   // fast path: the mantissa & the power of ten are both exact doubles, so a 
+   //  single multiply or divide is correctly rounded
+   static const double dPowersOf10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+   };
+   const unsigned long long nMaxExact = 1ULL << 53;
+
+   if (nMantissa == 0)
+   {
+      dValue = (bNegative ? -0.0 : 0.0);
+      return 0;
+   }
+
+   if (bTruncated == false && nMantissa <= nMaxExact)
+   {
+      // a few more digits can be shifted into the mantissa if it has room
+      while (nExponent > 22 && nMantissa * 10 <= nMaxExact) {
+         nMantissa *= 10;
+         --nExponent;
+      }
+
+      if (nExponent >= -22 && nExponent <= 22)
+      {
+         double d = static_cast<double>(nMantissa);
+         d = (nExponent < 0 ? d / dPowersOf10[-nExponent] : d * dPowersOf10[nExponent]);
+         dValue = (bNegative ? -d : d);
+         return 0;
+      }
+   }
+
+   // slow path: let strtod do the exact conversion. it honors the C locale's
+   //  decimal point, so swap that in to keep the result locale-independent
+   std::string sNumber(pBegin, pEnd);
+   char cDecimalPoint = *::localeconv()->decimal_point;
+   if (cDecimalPoint != '.')
+      std::replace(sNumber.begin(), sNumber.end(), '.', cDecimalPoint);
+   dValue = ::strtod(sNumber.c_str(), 0);
+   return 0;
+}
 
-   return sNumber;
+
+inline std::string Reader::MatchToken(InputStream& inputStream)
+{
+   // scans whatever token is next, for error reporting only. the parse functions 
+   //  below match what they expect directly
+   char c = inputStream.Peek();
+   switch (c)
+   {
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ',':
+      case ':':
+         inputStream.Get();
+         return std::string(1, c);
+
+      case '"':
+      {
+         std::string string;
+         MatchString(inputStream, string);
+         return string;
+      }
+
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+      {
+         std::string sNumber;
+         MatchNumber(inputStream, sNumber);
+         return sNumber;
+      }
+
+      case 't':
+         return MatchExpectedString(inputStream, "true");
+
+      case 'f':
+         return MatchExpectedString(inputStream, "false");
+
+      case 'n':
+         return MatchExpectedString(inputStream, "null");
+
+      default:
+      {
+         std::string sErrorMessage = std::string("Unexpected character in stream: ") + c;
+         throw ScanException(sErrorMessage, inputStream.GetLocation());
+      }
+   }
 }
 
 
-inline void Reader::Parse(UnknownElement& element, Reader::TokenStream& tokenStream) 
+inline void Reader::Parse(UnknownElement& element, Reader::InputStream& inputStream) 
 {
-   const Token& token = tokenStream.Peek();
-   switch (token.nType) {
-      case Token::TOKEN_OBJECT_BEGIN:
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS())
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   switch (inputStream.Peek()) {
+      case '{':
       {
-         // implicit non-const cast will perform conversion for us (if necessary)
-         Object& object = element;
-         Parse(object, tokenStream);
+         // reading into a document? then the new object belongs in its arena. otherwise it
+         //  goes on the heap, where copies can share it
+         Object& object = element.EmplaceObject(m_pArena);
+         Parse(object, inputStream);
          break;
       }
 
-      case Token::TOKEN_ARRAY_BEGIN:
+      case '[':
       {
-         Array& array = element;
-         Parse(array, tokenStream);
+         Array& array = element.EmplaceArray(m_pArena);
+         Parse(array, inputStream);
          break;
       }
 
-      case Token::TOKEN_STRING:
+      case '"':
       {
-         String& string = element;
-         Parse(string, tokenStream);
+         String& string = element.EmplaceString(m_pArena);
+         Parse(string, inputStream);
          break;
       }
 
-      case Token::TOKEN_NUMBER:
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
       {
          Number& number = element;
-         Parse(number, tokenStream);
+         Parse(number, inputStream);
          break;
       }
 
-      case Token::TOKEN_BOOLEAN:
+      case 't':
+      case 'f':
       {
          Boolean& boolean = element;
-         Parse(boolean, tokenStream);
+         Parse(boolean, inputStream);
          break;
       }
 
-      case Token::TOKEN_NULL:
+      case 'n':
       {
          Null& null = element;
-         Parse(null, tokenStream);
+         Parse(null, inputStream);
          break;
       }
 
       default:
-      {
-         std::string sMessage = std::string("Unexpected token: ") + token.sValue;
-         throw ParseException(sMessage, token.locBegin, token.locEnd);
-      }
+         ThrowUnexpectedToken("Unexpected token: ", inputStream);
    }
 }
 
 
-inline void Reader::Parse(Object& object, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Object& object, Reader::InputStream& inputStream)
 {
-   MatchExpectedToken(Token::TOKEN_OBJECT_BEGIN, tokenStream);
+   MatchExpectedToken('{', inputStream);
 
-   bool bContinue = (tokenStream.EOS() == false &&
-                     tokenStream.Peek().nType != Token::TOKEN_OBJECT_END);
+   EatWhiteSpace(inputStream);
+   bool bContinue = (inputStream.EOS() == false &&
+                     inputStream.Peek() != '}');
    while (bContinue)
    {
-      Object::Member member;
+      // first the member name. save its location in case we have to throw an exception
+      EatWhiteSpace(inputStream);
+      if (inputStream.EOS() || inputStream.Peek() != '"')
+         ThrowUnexpectedToken("Unexpected token: ", inputStream);
 
-      // first the member name. save the token in case we have to throw an exception
-      const Token& tokenName = tokenStream.Peek();
-      member.name = MatchExpectedToken(Token::TOKEN_STRING, tokenStream);
+      Location locNameBegin = inputStream.GetLocation();
+      m_sKey.clear();
+      MatchString(inputStream, m_sKey);
+      Object::Member member(m_pNames ? InternKey() : Name(m_sKey));
+      Location locNameEnd = inputStream.GetLocation();
 
       // ...then the key/value separator...
-      MatchExpectedToken(Token::TOKEN_MEMBER_ASSIGN, tokenStream);
+      MatchExpectedToken(':', inputStream);
+
+      // add the (still empty) member to the object now, so the value can be parsed 
+      //  straight into place. a duplicate name gets parsed on the side, since any 
+      //  problem with the value itself takes precedence
+      bool bDuplicate = (object.Position(member.name) != Object::Index::NOT_FOUND);
+      UnknownElement& element = bDuplicate ? member.element : object.Append(std::move(member))->element;
 
       // ...then the value itself (can be anything).
-      Parse(member.element, tokenStream);
+      Parse(element, inputStream);
 
-      // try adding it to the object (this could throw)
-      try
+      if (bDuplicate)
       {
-         object.Insert(member);
-      }
-      catch (Exception&)
-      {
-         // must be a duplicate name
-         std::string sMessage = std::string("Duplicate object member token: ") + member.name; 
-         throw ParseException(sMessage, tokenName.locBegin, tokenName.locEnd);
+         std::string sMessage = std::string("Duplicate object member token: ") + member.name.Value(); 
+         throw ParseException(sMessage, locNameBegin, locNameEnd);
       }
 
-      bContinue = (tokenStream.EOS() == false &&
-                   tokenStream.Peek().nType == Token::TOKEN_NEXT_ELEMENT);
+      EatWhiteSpace(inputStream);
+      bContinue = (inputStream.EOS() == false &&
+                   inputStream.Peek() == ',');
       if (bContinue)
-         MatchExpectedToken(Token::TOKEN_NEXT_ELEMENT, tokenStream);
+         MatchExpectedToken(',', inputStream);
    }
 
-   MatchExpectedToken(Token::TOKEN_OBJECT_END, tokenStream);
+   MatchExpectedToken('}', inputStream);
 }
 
 
-inline void Reader::Parse(Array& array, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Document& document, Reader::InputStream& inputStream)
 {
-   MatchExpectedToken(Token::TOKEN_ARRAY_BEGIN, tokenStream);
+   // start from scratch, & build everything in the document's arena
+   document.Clear();
+   m_pArena = &document.GetArena();
+   if (m_pNames != document.GetNames())
+   {
+      m_pNames = document.GetNames();
+      m_NameCache.clear();
+   }
+   Parse(document.Root(), inputStream);
+}
+
+
+inline void Reader::Parse(Array& array, Reader::InputStream& inputStream)
+{
+   MatchExpectedToken('[', inputStream);
+
+   EatWhiteSpace(inputStream);
+   bool bContinue = (inputStream.EOS() == false &&
+                     inputStream.Peek() != ']');
+
+   // an empty array starting with a number goes in packed, until proven otherwise
+   if (bContinue && array.Empty() &&
+       IsNumberStart(inputStream.Peek()))
+   {
+      array.Pack();
+      Number number;
+      while (bContinue)
+      {
+         EatWhiteSpace(inputStream);
+         if (inputStream.EOS() || 
+             IsNumberStart(inputStream.Peek()) == false)
+         {
+            array.Unpack();
+            break;
+         }
+
+         Parse(number, inputStream);
+         array.m_Numbers.push_back(number);
+
+         EatWhiteSpace(inputStream);
+         bContinue = (inputStream.EOS() == false &&
+                      inputStream.Peek() == ',');
+         if (bContinue)
+            MatchExpectedToken(',', inputStream);
+      }
+   }
 
-   bool bContinue = (tokenStream.EOS() == false &&
-                     tokenStream.Peek().nType != Token::TOKEN_ARRAY_END);
    while (bContinue)
    {
       // ...what's next? could be anything
       Array::iterator itElement = array.Insert(UnknownElement());
       UnknownElement& element = *itElement;
-      Parse(element, tokenStream);
+      Parse(element, inputStream);
 
-      bContinue = (tokenStream.EOS() == false &&
-                   tokenStream.Peek().nType == Token::TOKEN_NEXT_ELEMENT);
+      EatWhiteSpace(inputStream);
+      bContinue = (inputStream.EOS() == false &&
+                   inputStream.Peek() == ',');
       if (bContinue)
-         MatchExpectedToken(Token::TOKEN_NEXT_ELEMENT, tokenStream);
+         MatchExpectedToken(',', inputStream);
    }
 
-   MatchExpectedToken(Token::TOKEN_ARRAY_END, tokenStream);
+   MatchExpectedToken(']', inputStream);
 }
 
 
-inline void Reader::Parse(String& string, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(String& string, Reader::InputStream& inputStream)
 {
-   string = MatchExpectedToken(Token::TOKEN_STRING, tokenStream);
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS() || inputStream.Peek() != '"')
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   std::string& sValue = string.Value();
+   sValue.clear();
+   MatchString(inputStream, sValue);
 }
 
 
-inline void Reader::Parse(Number& number, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Number& number, Reader::InputStream& inputStream)
 {
-   const Token& currentToken = tokenStream.Peek(); // might need this later for throwing exception
-   const std::string& sValue = MatchExpectedToken(Token::TOKEN_NUMBER, tokenStream);
-
-   std::istringstream iStr(sValue);
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS() || 
+       IsNumberStart(inputStream.Peek()) == false)
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   // might need these later for throwing exception
+   Location locBegin = inputStream.GetLocation();
+   m_sNumber.clear();
+   MatchNumber(inputStream, m_sNumber);
+   Location locEnd = inputStream.GetLocation();
+
+   const char* pBegin = m_sNumber.data();
+   const char* pEnd = pBegin + m_sNumber.size();
    double dValue;
-   iStr >> dValue;
-
-   // did we consume all characters in the token?
-   if (iStr.eof() == false)
+   const char* pError = ConvertNumber(pBegin, pEnd, dValue);
+   if (pError == pEnd)
+   {
+      std::string sMessage = std::string("Incomplete NUMBER token: ") + m_sNumber;
+      throw ParseException(sMessage, locBegin, locEnd);
+   }
+   else if (pError != 0)
    {
-      char c = iStr.peek();
-      std::string sMessage = std::string("Unexpected character in NUMBER token: ") + c;
-      throw ParseException(sMessage, currentToken.locBegin, currentToken.locEnd);
+      std::string sMessage = std::string("Unexpected character in NUMBER token: ") + *pError;
+      throw ParseException(sMessage, locBegin, locEnd);
    }
 
    number = dValue;
 }
 
 
-inline void Reader::Parse(Boolean& boolean, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Boolean& boolean, Reader::InputStream& inputStream)
 {
-   const std::string& sValue = MatchExpectedToken(Token::TOKEN_BOOLEAN, tokenStream);
-   boolean = (sValue == "true" ? true : false);
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS() == false && inputStream.Peek() == 't') {
+      MatchExpectedString(inputStream, "true");
+      boolean = true;
+   }
+   else if (inputStream.EOS() == false && inputStream.Peek() == 'f') {
+      MatchExpectedString(inputStream, "false");
+      boolean = false;
+   }
+   else
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
 }
 
 
-inline void Reader::Parse(Null&, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Null&, Reader::InputStream& inputStream)
 {
-   MatchExpectedToken(Token::TOKEN_NULL, tokenStream);
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS() || inputStream.Peek() != 'n')
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   MatchExpectedString(inputStream, "null");
 }
 
 
-inline const std::string& Reader::MatchExpectedToken(Token::Type nExpected, Reader::TokenStream& tokenStream)
+inline void Reader::Parse(Handler& handler, Reader::InputStream& inputStream)
 {
-   const Token& token = tokenStream.Get();
-   if (token.nType != nExpected)
-   {
-      std::string sMessage = std::string("Unexpected token: ") + token.sValue;
-      throw ParseException(sMessage, token.locBegin, token.locEnd);
+   // same grammar as the element parsers above, but values are handed off as 
+   //  soon as they are complete, and the scratch buffers are recycled
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS())
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   switch (inputStream.Peek()) {
+      case '{':
+      {
+         MatchExpectedToken('{', inputStream);
+         handler.BeginObject();
+
+         EatWhiteSpace(inputStream);
+         bool bContinue = (inputStream.EOS() == false &&
+                           inputStream.Peek() != '}');
+         while (bContinue)
+         {
+            EatWhiteSpace(inputStream);
+            if (inputStream.EOS() || inputStream.Peek() != '"')
+               ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+            m_sKey.clear();
+            MatchString(inputStream, m_sKey);
+            MatchExpectedToken(':', inputStream);
+
+            handler.Key(m_sKey);
+            Parse(handler, inputStream);
+
+            EatWhiteSpace(inputStream);
+            bContinue = (inputStream.EOS() == false &&
+                         inputStream.Peek() == ',');
+            if (bContinue)
+               MatchExpectedToken(',', inputStream);
+         }
+
+         MatchExpectedToken('}', inputStream);
+         handler.EndObject();
+         break;
+      }
+
+      case '[':
+      {
+         MatchExpectedToken('[', inputStream);
+         handler.BeginArray();
+
+         EatWhiteSpace(inputStream);
+         bool bContinue = (inputStream.EOS() == false &&
+                           inputStream.Peek() != ']');
+         while (bContinue)
+         {
+            Parse(handler, inputStream);
+
+            EatWhiteSpace(inputStream);
+            bContinue = (inputStream.EOS() == false &&
+                         inputStream.Peek() == ',');
+            if (bContinue)
+               MatchExpectedToken(',', inputStream);
+         }
+
+         MatchExpectedToken(']', inputStream);
+         handler.EndArray();
+         break;
+      }
+
+      case '"':
+      {
+         Parse(m_String, inputStream);
+         handler.Value(m_String);
+         break;
+      }
+
+      case '-':
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+      {
+         Number number;
+         Parse(number, inputStream);
+         handler.Value(number);
+         break;
+      }
+
+      case 't':
+      case 'f':
+      {
+         Boolean boolean;
+         Parse(boolean, inputStream);
+         handler.Value(boolean);
+         break;
+      }
+
+      case 'n':
+      {
+         Null null;
+         Parse(null, inputStream);
+         handler.Value(null);
+         break;
+      }
+
+      default:
+         ThrowUnexpectedToken("Unexpected token: ", inputStream);
    }
+}
+
+
+inline void Reader::MatchExpectedToken(char cExpected, Reader::InputStream& inputStream)
+{
+   EatWhiteSpace(inputStream);
+   if (inputStream.EOS() || inputStream.Peek() != cExpected)
+      ThrowUnexpectedToken("Unexpected token: ", inputStream);
+
+   inputStream.Get();
+}
+
+
+inline void Reader::ThrowUnexpectedToken(const std::string& sPrefix, Reader::InputStream& inputStream)
+{
+   // scan the offending token so the exception can report it & where it lies
+   Location locBegin = inputStream.GetLocation();
+   if (inputStream.EOS())
+      throw ParseException("Unexpected end of token stream", locBegin, locBegin); // nowhere to point to
+
+   std::string sToken = MatchToken(inputStream);
+   throw ParseException(sPrefix + sToken, locBegin, inputStream.GetLocation());
+}
+
+
+
+///////////////
+// RecordReader
+
+inline RecordReader::RecordReader(std::istream& istr) :
+   m_pInputStream(new Reader::InputStream(istr))
+{}
+
+inline RecordReader::RecordReader(const char* pData, size_t nLength) :
+   m_pInputStream(new Reader::InputStream(pData, pData + nLength))
+{}
+
+inline RecordReader::RecordReader(std::istream& istr, NameTable& names) :
+   m_pInputStream(new Reader::InputStream(istr))
+{
+   m_Reader.m_pNames = &names;
+}
+
+inline RecordReader::RecordReader(const char* pData, size_t nLength, NameTable& names) :
+   m_pInputStream(new Reader::InputStream(pData, pData + nLength))
+{
+   m_Reader.m_pNames = &names;
+}
+
+inline RecordReader::~RecordReader()
+{
+   delete m_pInputStream;
+}
+
+inline bool RecordReader::Read(UnknownElement& element)
+{
+   m_Reader.EatWhiteSpace(*m_pInputStream);
+   if (m_pInputStream->EOS())
+      return false;
+
+   element = UnknownElement();
+   m_Reader.Parse(element, *m_pInputStream);
+   return true;
+}
+
+inline bool RecordReader::Read(Handler& handler)
+{
+   m_Reader.EatWhiteSpace(*m_pInputStream);
+   if (m_pInputStream->EOS())
+      return false;
 
-   return token.sValue;
+   m_Reader.Parse(handler, *m_pInputStream);
+   return true;
 }
 
-} // End namespace
+} // End namespace
\ No newline at end of file
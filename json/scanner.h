@@ -0,0 +1,91 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#if !defined(JSON_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define JSON_SIMD_X86
+#endif
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// Scanner - bulk character scanning kernels shared by Reader & Writer. On 
+//  x86-64 these run 16 (SSE2) or 32 (AVX2) bytes at a time, picked at runtime
+//  based on what the CPU supports; elsewhere they fall back to plain loops.
+//  Define JSON_DISABLE_SIMD to force the portable versions everywhere.
+
+class Scanner
+{
+public:
+   // returns the first character in [pBegin, pEnd) that isn't white space (in the
+   //  ::isspace sense), or pEnd. nLines receives the number of '\n' characters
+   //  skipped, and pLastNewLine the last of them (untouched if there were none)
+   static const char* SkipWhiteSpace(const char* pBegin, const char* pEnd, 
+                                     size_t& nLines, const char*& pLastNewLine);
+
+   // returns the first character in [pBegin, pEnd) that can't appear unescaped
+   //  inside a string ('"', '\\' or a control character), or pEnd
+   static const char* FindStringSpecial(const char* pBegin, const char* pEnd);
+
+   static bool IsWhiteSpace(char c);
+   static bool IsStringSpecial(char c);
+
+private:
+   typedef const char* (*SkipWhiteSpaceFunc)(const char*, const char*, size_t&, const char*&);
+   typedef const char* (*FindStringSpecialFunc)(const char*, const char*);
+
+   static const char* SkipWhiteSpace_Scalar(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine);
+   static const char* FindStringSpecial_Scalar(const char* pBegin, const char* pEnd);
+
+#ifdef JSON_SIMD_X86
+   static const char* SkipWhiteSpace_SSE2(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine);
+   static const char* FindStringSpecial_SSE2(const char* pBegin, const char* pEnd);
+   static const char* SkipWhiteSpace_AVX2(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine);
+   static const char* FindStringSpecial_AVX2(const char* pBegin, const char* pEnd);
+
+   static bool HasAVX2();
+
+   static unsigned int CountTrailingZeros(unsigned int nMask);
+   static unsigned int HighestBit(unsigned int nMask);
+   static unsigned int PopCount(unsigned int nMask);
+#endif
+
+   static SkipWhiteSpaceFunc SelectSkipWhiteSpace();
+   static FindStringSpecialFunc SelectFindStringSpecial();
+};
+
+
+} // End namespace
+
+
+#include "scanner.inl"
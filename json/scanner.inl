@@ -0,0 +1,278 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#ifdef JSON_SIMD_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define JSON_TARGET_AVX2
+#else
+#define JSON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace json
+{
+
+
+inline bool Scanner::IsWhiteSpace(char c)
+{
+   // same set as ::isspace in the "C" locale, without the function call
+   return c == ' ' || 
+          (c >= '\t' && c <= '\r');
+}
+
+inline bool Scanner::IsStringSpecial(char c)
+{
+   return c == '"' || 
+          c == '\\' ||
+          static_cast<unsigned char>(c) < 0x20;
+}
+
+inline const char* Scanner::SkipWhiteSpace(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine)
+{
+   static const SkipWhiteSpaceFunc pFunc = SelectSkipWhiteSpace();
+   return pFunc(pBegin, pEnd, nLines, pLastNewLine);
+}
+
+inline const char* Scanner::FindStringSpecial(const char* pBegin, const char* pEnd)
+{
+   static const FindStringSpecialFunc pFunc = SelectFindStringSpecial();
+   return pFunc(pBegin, pEnd);
+}
+
+
+//////////////////////////
+// portable implementations
+
+inline const char* Scanner::SkipWhiteSpace_Scalar(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine)
+{
+   for (; pBegin != pEnd && IsWhiteSpace(*pBegin); ++pBegin)
+   {
+      if (*pBegin == '\n') {
+         ++nLines;
+         pLastNewLine = pBegin;
+      }
+   }
+   return pBegin;
+}
+
+inline const char* Scanner::FindStringSpecial_Scalar(const char* pBegin, const char* pEnd)
+{
+   while (pBegin != pEnd && IsStringSpecial(*pBegin) == false)
+      ++pBegin;
+   return pBegin;
+}
+
+
+#ifndef JSON_SIMD_X86
+
+inline Scanner::SkipWhiteSpaceFunc Scanner::SelectSkipWhiteSpace()           { return &SkipWhiteSpace_Scalar; }
+inline Scanner::FindStringSpecialFunc Scanner::SelectFindStringSpecial()     { return &FindStringSpecial_Scalar; }
+
+#else
+
+inline Scanner::SkipWhiteSpaceFunc Scanner::SelectSkipWhiteSpace()
+{
+   return HasAVX2() ? &SkipWhiteSpace_AVX2 : &SkipWhiteSpace_SSE2;
+}
+
+inline Scanner::FindStringSpecialFunc Scanner::SelectFindStringSpecial()
+{
+   return HasAVX2() ? &FindStringSpecial_AVX2 : &FindStringSpecial_SSE2;
+}
+
+inline bool Scanner::HasAVX2()
+{
+#ifdef _MSC_VER
+   // AVX2 support flag, plus confirmation that the OS saves the YMM registers
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   if ((info[2] & (1 << 27)) == 0 ||       // OSXSAVE
+       (_xgetbv(0) & 6) != 6)
+      return false;
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#else
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+inline unsigned int Scanner::CountTrailingZeros(unsigned int nMask)
+{
+#ifdef _MSC_VER
+   unsigned long nIndex;
+   _BitScanForward(&nIndex, nMask);
+   return nIndex;
+#else
+   return __builtin_ctz(nMask);
+#endif
+}
+
+inline unsigned int Scanner::HighestBit(unsigned int nMask)
+{
+#ifdef _MSC_VER
+   unsigned long nIndex;
+   _BitScanReverse(&nIndex, nMask);
+   return nIndex;
+#else
+   return 31 - __builtin_clz(nMask);
+#endif
+}
+
+inline unsigned int Scanner::PopCount(unsigned int nMask)
+{
+   // popcnt instruction isn't guaranteed on every x86-64, so count the hard way
+   nMask = nMask - ((nMask >> 1) & 0x55555555);
+   nMask = (nMask & 0x33333333) + ((nMask >> 2) & 0x33333333);
+   return (((nMask + (nMask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+
+// each block is classified into bit masks (one bit per byte) by comparing 
+//  against the interesting characters. the block-wide ::isspace test is 
+//  "== ' '" or "'\t' <= c <= '\r'", the latter done as an unsigned saturating 
+//  subtraction so it needs no unsigned compare. the control character test 
+//  "c < 0x20" is likewise "min(c, 0x1F) == c"
+
+inline const char* Scanner::SkipWhiteSpace_SSE2(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine)
+{
+   const __m128i vSpace = _mm_set1_epi8(' ');
+   const __m128i vTab = _mm_set1_epi8('\t');
+   const __m128i vRange = _mm_set1_epi8('\r' - '\t');
+   const __m128i vNewLine = _mm_set1_epi8('\n');
+   const __m128i vZero = _mm_setzero_si128();
+
+   while (pEnd - pBegin >= 16)
+   {
+      __m128i vChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBegin));
+      __m128i vControl = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(vChars, vTab), vRange), vZero);
+      unsigned int nWhite = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(vChars, vSpace), vControl));
+      unsigned int nNewLines = _mm_movemask_epi8(_mm_cmpeq_epi8(vChars, vNewLine));
+
+      unsigned int nStop = ~nWhite & 0xFFFF;
+      if (nStop != 0)
+         nNewLines &= (1u << CountTrailingZeros(nStop)) - 1;
+
+      if (nNewLines != 0) {
+         nLines += PopCount(nNewLines);
+         pLastNewLine = pBegin + HighestBit(nNewLines);
+      }
+
+      if (nStop != 0)
+         return pBegin + CountTrailingZeros(nStop);
+      pBegin += 16;
+   }
+
+   return SkipWhiteSpace_Scalar(pBegin, pEnd, nLines, pLastNewLine);
+}
+
+inline const char* Scanner::FindStringSpecial_SSE2(const char* pBegin, const char* pEnd)
+{
+   const __m128i vQuote = _mm_set1_epi8('"');
+   const __m128i vBackslash = _mm_set1_epi8('\\');
+   const __m128i vControl = _mm_set1_epi8(0x1F);
+
+   while (pEnd - pBegin >= 16)
+   {
+      __m128i vChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBegin));
+      __m128i vSpecial = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(vChars, vQuote),
+                                                   _mm_cmpeq_epi8(vChars, vBackslash)),
+                                      _mm_cmpeq_epi8(_mm_min_epu8(vChars, vControl), vChars));
+      unsigned int nSpecial = _mm_movemask_epi8(vSpecial);
+      if (nSpecial != 0)
+         return pBegin + CountTrailingZeros(nSpecial);
+      pBegin += 16;
+   }
+
+   return FindStringSpecial_Scalar(pBegin, pEnd);
+}
+
+JSON_TARGET_AVX2 inline const char* Scanner::SkipWhiteSpace_AVX2(const char* pBegin, const char* pEnd, size_t& nLines, const char*& pLastNewLine)
+{
+   const __m256i vSpace = _mm256_set1_epi8(' ');
+   const __m256i vTab = _mm256_set1_epi8('\t');
+   const __m256i vRange = _mm256_set1_epi8('\r' - '\t');
+   const __m256i vNewLine = _mm256_set1_epi8('\n');
+   const __m256i vZero = _mm256_setzero_si256();
+
+   while (pEnd - pBegin >= 32)
+   {
+      __m256i vChars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pBegin));
+      __m256i vControl = _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8(vChars, vTab), vRange), vZero);
+      unsigned int nWhite = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(vChars, vSpace), vControl));
+      unsigned int nNewLines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(vChars, vNewLine));
+
+      unsigned int nStop = ~nWhite;
+      if (nStop != 0)
+         nNewLines &= (1u << CountTrailingZeros(nStop)) - 1;
+
+      if (nNewLines != 0) {
+         nLines += PopCount(nNewLines);
+         pLastNewLine = pBegin + HighestBit(nNewLines);
+      }
+
+      if (nStop != 0)
+         return pBegin + CountTrailingZeros(nStop);
+      pBegin += 32;
+   }
+
+   return SkipWhiteSpace_SSE2(pBegin, pEnd, nLines, pLastNewLine);
+}
+
+JSON_TARGET_AVX2 inline const char* Scanner::FindStringSpecial_AVX2(const char* pBegin, const char* pEnd)
+{
+   const __m256i vQuote = _mm256_set1_epi8('"');
+   const __m256i vBackslash = _mm256_set1_epi8('\\');
+   const __m256i vControl = _mm256_set1_epi8(0x1F);
+
+   while (pEnd - pBegin >= 32)
+   {
+      __m256i vChars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pBegin));
+      __m256i vSpecial = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(vChars, vQuote),
+                                                         _mm256_cmpeq_epi8(vChars, vBackslash)),
+                                         _mm256_cmpeq_epi8(_mm256_min_epu8(vChars, vControl), vChars));
+      unsigned int nSpecial = _mm256_movemask_epi8(vSpecial);
+      if (nSpecial != 0)
+         return pBegin + CountTrailingZeros(nSpecial);
+      pBegin += 32;
+   }
+
+   return FindStringSpecial_SSE2(pBegin, pEnd);
+}
+
+#endif // JSON_SIMD_X86
+
+
+} // End namespace
@@ -0,0 +1,118 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#pragma once
+
+#include "elements.h"
+#include "visitor.h"
+#include "writer.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace json
+{
+
+/////////////////////////////////////////////////////////////////////////
+// StreamWriter - writes a document as it's described, a value at a time, 
+//  without building an element tree first. The output is exactly what Writer 
+//  would produce for the same tree (same layout options, escaping & numbers).
+//
+//  StreamWriter writer(ostr);
+//  writer.BeginObject();
+//  writer.Key("Invoices");
+//  writer.BeginArray();
+//  for (...)
+//     writer.Value(Number(dTotal));
+//  writer.EndArray();
+//  writer.EndObject();
+//  writer.Finish();
+//
+// Calls are checked as they're made: a value where a member name belongs, an
+//  unbalanced End, or anything after the root element is complete throws 
+//  json::Exception. Output is buffered; Finish() verifies the document is 
+//  complete & hands the rest to the stream or sink.
+// StreamWriter is also a Handler, so Reader::Read(writer, ...) reformats a 
+//  document straight from input to output.
+
+class StreamWriter : public Handler
+{
+public:
+   StreamWriter(std::ostream& ostr, const Writer::Options& options = Writer::Options());
+   StreamWriter(Writer::Sink& sink, const Writer::Options& options = Writer::Options());
+
+   // appends to sOut, which holds the output as it's written
+   StreamWriter(std::string& sOut, const Writer::Options& options = Writer::Options());
+
+   ~StreamWriter();
+
+   virtual void BeginObject();
+   virtual void Key(const std::string& name);
+   virtual void EndObject();
+
+   virtual void BeginArray();
+   virtual void EndArray();
+
+   virtual void Value(const Number& number);
+   virtual void Value(const String& string);
+   virtual void Value(const Boolean& boolean);
+   virtual void Value(const Null& null);
+
+   // a whole subtree at once
+   void Value(const UnknownElement& element);
+
+   // throws if the document isn't complete, then flushes the output
+   void Finish();
+
+   bool IsComplete() const;
+
+private:
+   StreamWriter(const StreamWriter&);               // not copyable
+   StreamWriter& operator = (const StreamWriter&);
+
+   // checks a value can go here, & separates it from the previous one
+   void BeginValue();
+   void EndValue();
+
+   std::string m_sBuffer;              // output in waiting, unless writing to a string
+   Writer::StreamSink* m_pStreamSink;  // when writing to an ostream
+   std::ostream* m_pStream;
+   Writer m_Writer;
+
+   std::vector<char> m_Containers;     // '{' or '[' for each open container
+   bool m_bFirst;                      // nothing in the innermost container yet
+   bool m_bKey;                        // member name written, value expected
+   bool m_bComplete;
+};
+
+
+} // End namespace
+
+
+#include "streamwriter.inl"
@@ -0,0 +1,226 @@
+/******************************************************************************
+
+Copyright (c) 2009-2010, Terry Caton
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright 
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the projecct nor the names of its contributors 
+      may be used to endorse or promote products derived from this software 
+      without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+******************************************************************************/
+
+#include "streamwriter.h"
+#include <iostream>
+
+namespace json
+{
+
+
+inline StreamWriter::StreamWriter(std::ostream& ostr, const Writer::Options& options) :
+   m_pStreamSink(new Writer::StreamSink(ostr)),
+   m_pStream(&ostr),
+   m_Writer(m_sBuffer, m_pStreamSink, options),
+   m_bFirst(true),
+   m_bKey(false),
+   m_bComplete(false)
+{
+   m_sBuffer.reserve(Writer::BUFFER_SIZE + Writer::BUFFER_SIZE / 4);
+}
+
+inline StreamWriter::StreamWriter(Writer::Sink& sink, const Writer::Options& options) :
+   m_pStreamSink(0),
+   m_pStream(0),
+   m_Writer(m_sBuffer, &sink, options),
+   m_bFirst(true),
+   m_bKey(false),
+   m_bComplete(false)
+{
+   m_sBuffer.reserve(Writer::BUFFER_SIZE + Writer::BUFFER_SIZE / 4);
+}
+
+inline StreamWriter::StreamWriter(std::string& sOut, const Writer::Options& options) :
+   m_pStreamSink(0),
+   m_pStream(0),
+   m_Writer(sOut, 0, options),
+   m_bFirst(true),
+   m_bKey(false),
+   m_bComplete(false)
+{}
+
+inline StreamWriter::~StreamWriter()
+{
+   delete m_pStreamSink;
+}
+
+
+inline void StreamWriter::BeginObject()
+{
+   BeginValue();
+   m_Writer.m_sOut.push_back('{');
+   ++m_Writer.m_nTabDepth;
+
+   m_Containers.push_back('{');
+   m_bFirst = true;
+}
+
+inline void StreamWriter::Key(const std::string& name)
+{
+   if (m_Containers.empty() || m_Containers.back() != '{')
+      throw Exception("Member name outside of an object: " + name);
+   if (m_bKey)
+      throw Exception("Expected value after member name, got another name: " + name);
+
+   if (m_bFirst == false)
+      m_Writer.m_sOut.push_back(',');
+   m_Writer.NewLine();
+   m_bFirst = false;
+
+   m_Writer.WriteString(name);
+   m_Writer.NameSeparator();
+   m_bKey = true;
+}
+
+inline void StreamWriter::EndObject()
+{
+   if (m_Containers.empty() || m_Containers.back() != '{')
+      throw Exception("EndObject without a matching BeginObject");
+   if (m_bKey)
+      throw Exception("Expected value after member name, got end of object");
+
+   // empty containers are written "{}", same as Writer
+   --m_Writer.m_nTabDepth;
+   if (m_bFirst == false)
+      m_Writer.NewLine();
+   m_Writer.m_sOut.push_back('}');
+
+   m_Containers.pop_back();
+   m_bFirst = false;
+   EndValue();
+}
+
+inline void StreamWriter::BeginArray()
+{
+   BeginValue();
+   m_Writer.m_sOut.push_back('[');
+   ++m_Writer.m_nTabDepth;
+
+   m_Containers.push_back('[');
+   m_bFirst = true;
+}
+
+inline void StreamWriter::EndArray()
+{
+   if (m_Containers.empty() || m_Containers.back() != '[')
+      throw Exception("EndArray without a matching BeginArray");
+
+   --m_Writer.m_nTabDepth;
+   if (m_bFirst == false)
+      m_Writer.NewLine();
+   m_Writer.m_sOut.push_back(']');
+
+   m_Containers.pop_back();
+   m_bFirst = false;
+   EndValue();
+}
+
+inline void StreamWriter::Value(const Number& number)
+{
+   BeginValue();
+   m_Writer.Write_i(number);
+   EndValue();
+}
+
+inline void StreamWriter::Value(const String& string)
+{
+   BeginValue();
+   m_Writer.Write_i(string);
+   EndValue();
+}
+
+inline void StreamWriter::Value(const Boolean& boolean)
+{
+   BeginValue();
+   m_Writer.Write_i(boolean);
+   EndValue();
+}
+
+inline void StreamWriter::Value(const Null& null)
+{
+   BeginValue();
+   m_Writer.Write_i(null);
+   EndValue();
+}
+
+inline void StreamWriter::Value(const UnknownElement& element)
+{
+   BeginValue();
+   m_Writer.Write_i(element);
+   EndValue();
+}
+
+inline void StreamWriter::Finish()
+{
+   if (m_bComplete == false)
+      throw Exception(m_Containers.empty() ? "Document is empty" : "Document is incomplete: unclosed object or array");
+
+   m_Writer.Drain(1);
+   if (m_pStream)
+      m_pStream->flush();
+}
+
+inline bool StreamWriter::IsComplete() const
+{
+   return m_bComplete;
+}
+
+inline void StreamWriter::BeginValue()
+{
+   if (m_bComplete)
+      throw Exception("Document is already complete");
+
+   if (m_Containers.empty())
+      return; // root
+
+   if (m_Containers.back() == '{')
+   {
+      // the member name has taken care of the separator & layout already
+      if (m_bKey == false)
+         throw Exception("Expected member name, got a value");
+      m_bKey = false;
+   }
+   else
+   {
+      if (m_bFirst == false)
+         m_Writer.m_sOut.push_back(',');
+      m_Writer.NewLine();
+      m_bFirst = false;
+   }
+}
+
+inline void StreamWriter::EndValue()
+{
+   if (m_Containers.empty())
+      m_bComplete = true;
+   m_Writer.Drain(Writer::BUFFER_SIZE);
+}
+
+
+} // End namespace
@@ -62,4 +62,29 @@ public:
 };
 
 
+/////////////////////////////////////////////////////////////////////////
+// Handler - receives a document as a sequence of events, in document order, 
+//  without any element tree being built (see Reader::Read(Handler&, ...)). 
+//  Object members arrive as Key() followed by the member's value; 
+//  duplicate member names are passed along as they are.
+
+class Handler
+{
+public:
+   virtual ~Handler() {}
+
+   virtual void BeginObject() = 0;
+   virtual void Key(const std::string& name) = 0;
+   virtual void EndObject() = 0;
+
+   virtual void BeginArray() = 0;
+   virtual void EndArray() = 0;
+
+   virtual void Value(const Number& number) = 0;
+   virtual void Value(const String& string) = 0;
+   virtual void Value(const Boolean& boolean) = 0;
+   virtual void Value(const Null& null) = 0;
+};
+
+
 } // End namespace
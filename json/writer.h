@@ -30,7 +30,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
 #include "elements.h"
+#include "scanner.h"
 #include "visitor.h"
+#include <iosfwd>
+#include <string>
 
 namespace json
 {
@@ -38,19 +41,71 @@ namespace json
 class Writer : private ConstVisitor
 {
 public:
-   static void Write(const Object& object, std::ostream& ostr);
-   static void Write(const Array& array, std::ostream& ostr);
-   static void Write(const String& string, std::ostream& ostr);
-   static void Write(const Number& number, std::ostream& ostr);
-   static void Write(const Boolean& boolean, std::ostream& ostr);
-   static void Write(const Null& null, std::ostream& ostr);
-   static void Write(const UnknownElement& elementRoot, std::ostream& ostr);
+   // how the output is laid out. the defaults give the usual layout: one value per
+   //  line, indented a tab per level
+   struct Options
+   {
+      Options();
+
+      bool m_bCompact;              // no white space at all; the rest are ignored
+      char m_cIndent;               // indentation character
+      unsigned int m_nIndentSize;   // ...& how many of them per level
+   };
+
+   // somewhere else for the output to go (a socket, a compressor...). the writer
+   //  buffers, so Append is handed large runs of bytes at a time
+   class Sink
+   {
+   public:
+      virtual ~Sink() {}
+      virtual void Append(const char* pData, size_t nLength) = 0;
+   };
+
+   static void Write(const Object& object, std::ostream& ostr, const Options& options = Options());
+   static void Write(const Array& array, std::ostream& ostr, const Options& options = Options());
+   static void Write(const String& string, std::ostream& ostr, const Options& options = Options());
+   static void Write(const Number& number, std::ostream& ostr, const Options& options = Options());
+   static void Write(const Boolean& boolean, std::ostream& ostr, const Options& options = Options());
+   static void Write(const Null& null, std::ostream& ostr, const Options& options = Options());
+   static void Write(const UnknownElement& elementRoot, std::ostream& ostr, const Options& options = Options());
+
+   // straight into memory: the output is appended to sOut, which can be reused 
+   //  (capacity & all) from one document to the next
+   static void Write(const Object& object, std::string& sOut, const Options& options = Options());
+   static void Write(const Array& array, std::string& sOut, const Options& options = Options());
+   static void Write(const String& string, std::string& sOut, const Options& options = Options());
+   static void Write(const Number& number, std::string& sOut, const Options& options = Options());
+   static void Write(const Boolean& boolean, std::string& sOut, const Options& options = Options());
+   static void Write(const Null& null, std::string& sOut, const Options& options = Options());
+   static void Write(const UnknownElement& elementRoot, std::string& sOut, const Options& options = Options());
+
+   static void Write(const Object& object, Sink& sink, const Options& options = Options());
+   static void Write(const Array& array, Sink& sink, const Options& options = Options());
+   static void Write(const String& string, Sink& sink, const Options& options = Options());
+   static void Write(const Number& number, Sink& sink, const Options& options = Options());
+   static void Write(const Boolean& boolean, Sink& sink, const Options& options = Options());
+   static void Write(const Null& null, Sink& sink, const Options& options = Options());
+   static void Write(const UnknownElement& elementRoot, Sink& sink, const Options& options = Options());
 
 private:
-   Writer(std::ostream& ostr);
+   friend class StreamWriter;
+
+   class StreamSink;
+
+   // output collects in a buffer (sOut itself, if that's where it's going), which
+   //  is handed to the sink whenever it reaches this size
+   enum { BUFFER_SIZE = 64 * 1024 };
+
+   Writer(std::string& sOut, Sink* pSink, const Options& options);
+
+   template <typename ElementTypeT>
+   static void Write_i(const ElementTypeT& element, std::ostream& ostr, const Options& options);
+
+   template <typename ElementTypeT>
+   static void Write_i(const ElementTypeT& element, std::string& sOut, const Options& options);
 
    template <typename ElementTypeT>
-   static void Write_i(const ElementTypeT& element, std::ostream& ostr);
+   static void Write_i(const ElementTypeT& element, Sink& sink, const Options& options);
 
    void Write_i(const Object& object);
    void Write_i(const Array& array);
@@ -60,6 +115,9 @@ private:
    void Write_i(const Null& null);
    void Write_i(const UnknownElement& unknown);
 
+   // quoted & escaped
+   void WriteString(const std::string& s);
+
    virtual void Visit(const Array& array);
    virtual void Visit(const Object& object);
    virtual void Visit(const Number& number);
@@ -67,8 +125,30 @@ private:
    virtual void Visit(const Boolean& boolean);
    virtual void Visit(const Null& null);
 
-   std::ostream& m_ostr;
+   // numbers are written with the fewest digits that read back as the same double
+   //  (Grisu2), and whole numbers without any floating point work at all. returns 
+   //  the length written to pBuffer, which must have room for NUMBER_SIZE characters
+   enum { NUMBER_SIZE = 32 };
+   static size_t FormatNumber(double dValue, char* pBuffer);
+
+   struct DiyFp;
+   static void Grisu2(double dValue, char* pDigits, int& nLength, int& nK);
+   static void DigitGen(const DiyFp& w, const DiyFp& mp, unsigned long long nDelta, char* pDigits, int& nLength, int& nK);
+   static void GrisuRound(char* pDigits, int nLength, unsigned long long nDelta, unsigned long long nRest, 
+                          unsigned long long nTenKappa, unsigned long long nDistance);
+
+   // layout
+   void NewLine();
+   void NameSeparator();
+
+   // passes the buffer on to the sink (if any), once it holds at least nMinimum bytes
+   void Drain(size_t nMinimum);
+
+   std::string& m_sOut;
+   Sink* m_pSink;
+   Options m_Options;
    int m_nTabDepth;
+   std::string m_sIndent;     // grown as needed, & reused for every line
 };
 
 
@@ -28,8 +28,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ******************************************************************************/
 
 #include "writer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
-#include <iomanip>
 
 /*  
 
@@ -43,129 +45,535 @@ namespace json
 {
 
 
-inline void Writer::Write(const UnknownElement& elementRoot, std::ostream& ostr) { Write_i(elementRoot, ostr); }
-inline void Writer::Write(const Object& object, std::ostream& ostr)              { Write_i(object, ostr); }
-inline void Writer::Write(const Array& array, std::ostream& ostr)                { Write_i(array, ostr); }
-inline void Writer::Write(const Number& number, std::ostream& ostr)              { Write_i(number, ostr); }
-inline void Writer::Write(const String& string, std::ostream& ostr)              { Write_i(string, ostr); }
-inline void Writer::Write(const Boolean& boolean, std::ostream& ostr)            { Write_i(boolean, ostr); }
-inline void Writer::Write(const Null& null, std::ostream& ostr)                  { Write_i(null, ostr); }
+inline void Writer::Write(const UnknownElement& elementRoot, std::ostream& ostr, const Options& options) { Write_i(elementRoot, ostr, options); }
+inline void Writer::Write(const Object& object, std::ostream& ostr, const Options& options)              { Write_i(object, ostr, options); }
+inline void Writer::Write(const Array& array, std::ostream& ostr, const Options& options)                { Write_i(array, ostr, options); }
+inline void Writer::Write(const Number& number, std::ostream& ostr, const Options& options)              { Write_i(number, ostr, options); }
+inline void Writer::Write(const String& string, std::ostream& ostr, const Options& options)              { Write_i(string, ostr, options); }
+inline void Writer::Write(const Boolean& boolean, std::ostream& ostr, const Options& options)            { Write_i(boolean, ostr, options); }
+inline void Writer::Write(const Null& null, std::ostream& ostr, const Options& options)                  { Write_i(null, ostr, options); }
+
+inline void Writer::Write(const UnknownElement& elementRoot, std::string& sOut, const Options& options)  { Write_i(elementRoot, sOut, options); }
+inline void Writer::Write(const Object& object, std::string& sOut, const Options& options)               { Write_i(object, sOut, options); }
+inline void Writer::Write(const Array& array, std::string& sOut, const Options& options)                 { Write_i(array, sOut, options); }
+inline void Writer::Write(const Number& number, std::string& sOut, const Options& options)               { Write_i(number, sOut, options); }
+inline void Writer::Write(const String& string, std::string& sOut, const Options& options)               { Write_i(string, sOut, options); }
+inline void Writer::Write(const Boolean& boolean, std::string& sOut, const Options& options)             { Write_i(boolean, sOut, options); }
+inline void Writer::Write(const Null& null, std::string& sOut, const Options& options)                   { Write_i(null, sOut, options); }
+
+inline void Writer::Write(const UnknownElement& elementRoot, Sink& sink, const Options& options)         { Write_i(elementRoot, sink, options); }
+inline void Writer::Write(const Object& object, Sink& sink, const Options& options)                      { Write_i(object, sink, options); }
+inline void Writer::Write(const Array& array, Sink& sink, const Options& options)                        { Write_i(array, sink, options); }
+inline void Writer::Write(const Number& number, Sink& sink, const Options& options)                      { Write_i(number, sink, options); }
+inline void Writer::Write(const String& string, Sink& sink, const Options& options)                      { Write_i(string, sink, options); }
+inline void Writer::Write(const Boolean& boolean, Sink& sink, const Options& options)                    { Write_i(boolean, sink, options); }
+inline void Writer::Write(const Null& null, Sink& sink, const Options& options)                          { Write_i(null, sink, options); }
+
+
+inline Writer::Options::Options() :
+   m_bCompact(false),
+   m_cIndent('\t'),
+   m_nIndentSize(1)
+{}
+
+
+// hands the buffered output to a stream a block at a time, skipping ostream's 
+//  per-token sentry & formatting overhead
+class Writer::StreamSink : public Writer::Sink
+{
+public:
+   StreamSink(std::ostream& ostr) : m_ostr(ostr) {}
+   virtual void Append(const char* pData, size_t nLength) { m_ostr.write(pData, nLength); }
 
+private:
+   std::ostream& m_ostr;
+};
 
-inline Writer::Writer(std::ostream& ostr) :
-   m_ostr(ostr),
+
+inline Writer::Writer(std::string& sOut, Sink* pSink, const Options& options) :
+   m_sOut(sOut),
+   m_pSink(pSink),
+   m_Options(options),
    m_nTabDepth(0)
 {}
 
 template <typename ElementTypeT>
-void Writer::Write_i(const ElementTypeT& element, std::ostream& ostr)
+void Writer::Write_i(const ElementTypeT& element, std::ostream& ostr, const Options& options)
 {
-   Writer writer(ostr);
-   writer.Write_i(element);
+   StreamSink sink(ostr);
+   Write_i(element, sink, options);
    ostr.flush(); // all done
 }
 
+template <typename ElementTypeT>
+void Writer::Write_i(const ElementTypeT& element, std::string& sOut, const Options& options)
+{
+   Writer writer(sOut, 0, options);
+   writer.Write_i(element);
+}
+
+template <typename ElementTypeT>
+void Writer::Write_i(const ElementTypeT& element, Sink& sink, const Options& options)
+{
+   std::string sBuffer;
+   sBuffer.reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+
+   Writer writer(sBuffer, &sink, options);
+   writer.Write_i(element);
+   writer.Drain(1);
+}
+
 inline void Writer::Write_i(const Array& array)
 {
    if (array.Empty())
-      m_ostr << "[]";
+      m_sOut.append("[]", 2);
    else
    {
-      m_ostr << '[' << std::endl;
+      m_sOut.push_back('[');
       ++m_nTabDepth;
 
-      Array::const_iterator it(array.Begin()),
-                            itEnd(array.End());
-      while (it != itEnd) {
-         m_ostr << std::string(m_nTabDepth, '\t');
-         
-         Write_i(*it);
-
-         if (++it != itEnd)
-            m_ostr << ',';
-         m_ostr << std::endl;
+      // packed numbers are written as they are, no need to unpack them
+      if (const double* pNumbers = array.Numbers())
+      {
+         const double* pEnd = pNumbers + array.Size();
+         while (pNumbers != pEnd) {
+            NewLine();
+            Write_i(Number(*pNumbers));
+
+            if (++pNumbers != pEnd)
+               m_sOut.push_back(',');
+            Drain(BUFFER_SIZE);
+         }
+      }
+      else
+      {
+         Array::const_iterator it(array.Begin()),
+                               itEnd(array.End());
+         while (it != itEnd) {
+            NewLine();
+            Write_i(*it);
+
+            if (++it != itEnd)
+               m_sOut.push_back(',');
+            Drain(BUFFER_SIZE);
+         }
       }
 
       --m_nTabDepth;
-      m_ostr << std::string(m_nTabDepth, '\t') << ']';
+      NewLine();
+      m_sOut.push_back(']');
    }
 }
 
 inline void Writer::Write_i(const Object& object)
 {
    if (object.Empty())
-      m_ostr << "{}";
+      m_sOut.append("{}", 2);
    else
    {
-      m_ostr << '{' << std::endl;
+      m_sOut.push_back('{');
       ++m_nTabDepth;
 
       Object::const_iterator it(object.Begin()),
                              itEnd(object.End());
       while (it != itEnd) {
-         m_ostr << std::string(m_nTabDepth, '\t');
-         
-         Write_i(it->name);
+         NewLine();
+         WriteString(it->name.Value());
 
-         m_ostr << " : ";
+         NameSeparator();
          Write_i(it->element); 
 
          if (++it != itEnd)
-            m_ostr << ',';
-         m_ostr << std::endl;
+            m_sOut.push_back(',');
+         Drain(BUFFER_SIZE);
       }
 
       --m_nTabDepth;
-      m_ostr << std::string(m_nTabDepth, '\t') << '}';
+      NewLine();
+      m_sOut.push_back('}');
+   }
+}
+
+inline void Writer::NewLine()
+{
+   if (m_Options.m_bCompact)
+      return;
+
+   size_t nIndent = m_nTabDepth * m_Options.m_nIndentSize;
+   if (m_sIndent.size() < nIndent)
+      m_sIndent.append(nIndent - m_sIndent.size(), m_Options.m_cIndent);
+
+   m_sOut.push_back('\n');
+   m_sOut.append(m_sIndent.data(), nIndent);
+}
+
+inline void Writer::NameSeparator()
+{
+   if (m_Options.m_bCompact)
+      m_sOut.push_back(':');
+   else
+      m_sOut.append(" : ", 3);
+}
+
+inline void Writer::Drain(size_t nMinimum)
+{
+   if (m_pSink && m_sOut.size() >= nMinimum)
+   {
+      m_pSink->Append(m_sOut.data(), m_sOut.size());
+      m_sOut.clear();
    }
 }
 
 inline void Writer::Write_i(const Number& numberElement)
 {
-   m_ostr << std::setprecision(20) << numberElement.Value();
+   char szNumber[NUMBER_SIZE];
+   m_sOut.append(szNumber, FormatNumber(numberElement.Value(), szNumber));
 }
 
 inline void Writer::Write_i(const Boolean& booleanElement)
 {
-   m_ostr << (booleanElement.Value() ? "true" : "false");
+   if (booleanElement.Value())
+      m_sOut.append("true", 4);
+   else
+      m_sOut.append("false", 5);
 }
 
 inline void Writer::Write_i(const String& stringElement)
 {
-   m_ostr << '"';
+   WriteString(stringElement.Value());
+}
+
+inline void Writer::WriteString(const std::string& s)
+{
+   static const char szHex[] = "0123456789ABCDEF";
 
-   const std::string& s = stringElement.Value();
-   std::string::const_iterator it(s.begin()),
-                               itEnd(s.end());
-   for (; it != itEnd; ++it)
+   m_sOut.push_back('"');
+
+   const char* p = s.data();
+   const char* pEnd = p + s.size();
+   while (p != pEnd)
    {
-      switch (*it)
+      // plain characters are copied over in bulk, up to whatever needs escaping...
+      const char* pRunEnd = Scanner::FindStringSpecial(p, pEnd);
+      m_sOut.append(p, pRunEnd);
+      if (pRunEnd == pEnd)
+         break;
+
+      // ...which is a quote, a backslash or a control character
+      p = pRunEnd;
+      switch (*p)
       {
-         case '"':         m_ostr << "\\\"";   break;
-         case '\\':        m_ostr << "\\\\";   break;
-         case '\b':        m_ostr << "\\b";    break;
-         case '\f':        m_ostr << "\\f";    break;
-         case '\n':        m_ostr << "\\n";    break;
-         case '\r':        m_ostr << "\\r";    break;
-         case '\t':        m_ostr << "\\t";    break;
-         case '\u':        m_ostr << "\\u";    break; // uh...
-         default:          m_ostr << *it;      break;
+         case '"':         m_sOut.append("\\\"", 2);   break;
+         case '\\':        m_sOut.append("\\\\", 2);   break;
+         case '\b':        m_sOut.append("\\b", 2);    break;
+         case '\f':        m_sOut.append("\\f", 2);    break;
+         case '\n':        m_sOut.append("\\n", 2);    break;
+         case '\r':        m_sOut.append("\\r", 2);    break;
+         case '\t':        m_sOut.append("\\t", 2);    break;
+         default: {
+            char szEscape[] = { '\\', 'u', '0', '0', szHex[(*p >> 4) & 0xF], szHex[*p & 0xF] };
+            m_sOut.append(szEscape, sizeof(szEscape));
+            break;
+         }
       }
+      ++p;
    }
 
-   m_ostr << '"';   
+   m_sOut.push_back('"');   
 }
 
 inline void Writer::Write_i(const Null& )
 {
-   m_ostr << "null";
+   m_sOut.append("null", 4);
 }
 
 inline void Writer::Write_i(const UnknownElement& unknown)
 {
-   unknown.Accept(*this); 
+   // we're done with each reference before moving on, so no need to pin anything
+   unknown.Peek(*this); 
+}
+
+// a do-it-yourself floating point number: f * 2^e, with a full 64 bit significand
+struct Writer::DiyFp
+{
+   DiyFp(unsigned long long nF = 0, int nE = 0) : f(nF), e(nE) {}
+
+   explicit DiyFp(double dValue)
+   {
+      unsigned long long nBits;
+      std::memcpy(&nBits, &dValue, sizeof(nBits));
+
+      int nBiasedExponent = static_cast<int>((nBits >> 52) & 0x7FF);
+      f = nBits & FRACTION_MASK;
+      if (nBiasedExponent != 0) {
+         f += HIDDEN_BIT;
+         e = nBiasedExponent - 1075;
+      }
+      else
+         e = -1074; // subnormal
+   }
+
+   DiyFp operator - (const DiyFp& rhs) const { return DiyFp(f - rhs.f, e); }
+
+   // the upper half of the 128 bit product, rounded
+   DiyFp operator * (const DiyFp& rhs) const
+   {
+      const unsigned long long M32 = 0xFFFFFFFFULL;
+      unsigned long long a = f >> 32, b = f & M32,
+                         c = rhs.f >> 32, d = rhs.f & M32;
+      unsigned long long ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+      unsigned long long nMid = (bd >> 32) + (ad & M32) + (bc & M32) + (1ULL << 31);
+      return DiyFp(ac + (ad >> 32) + (bc >> 32) + (nMid >> 32), e + rhs.e + 64);
+   }
+
+   DiyFp Normalize() const
+   {
+      DiyFp result(*this);
+      while ((result.f & (1ULL << 63)) == 0) {
+         result.f <<= 1;
+         --result.e;
+      }
+      return result;
+   }
+
+   // the neighbors halfway to the next double down & up, sharing the upper one's exponent
+   void NormalizedBoundaries(DiyFp& minus, DiyFp& plus) const
+   {
+      plus = DiyFp((f << 1) + 1, e - 1).Normalize();
+      minus = (f == HIDDEN_BIT ? DiyFp((f << 2) - 1, e - 2) : DiyFp((f << 1) - 1, e - 1));
+      minus.f <<= minus.e - plus.e;
+      minus.e = plus.e;
+   }
+
+   // the cached power of ten that brings a number with binary exponent nE into 
+   //  the range Grisu works in. nK receives the (negated) decimal exponent
+   static DiyFp CachedPower(int nE, int& nK)
+   {
+      // 10^-348, 10^-340, ..., 10^340, as normalized 64 bit significands
+      static const struct { unsigned long long f; int e; } powers[] = {
+      { 0xfa8fd5a0081c0288ULL, -1220 }, { 0xbaaee17fa23ebf76ULL, -1193 }, { 0x8b16fb203055ac76ULL, -1166 },
+      { 0xcf42894a5dce35eaULL, -1140 }, { 0x9a6bb0aa55653b2dULL, -1113 }, { 0xe61acf033d1a45dfULL, -1087 },
+      { 0xab70fe17c79ac6caULL, -1060 }, { 0xff77b1fcbebcdc4fULL, -1034 }, { 0xbe5691ef416bd60cULL, -1007 },
+      { 0x8dd01fad907ffc3cULL,  -980 }, { 0xd3515c2831559a83ULL,  -954 }, { 0x9d71ac8fada6c9b5ULL,  -927 },
+      { 0xea9c227723ee8bcbULL,  -901 }, { 0xaecc49914078536dULL,  -874 }, { 0x823c12795db6ce57ULL,  -847 },
+      { 0xc21094364dfb5637ULL,  -821 }, { 0x9096ea6f3848984fULL,  -794 }, { 0xd77485cb25823ac7ULL,  -768 },
+      { 0xa086cfcd97bf97f4ULL,  -741 }, { 0xef340a98172aace5ULL,  -715 }, { 0xb23867fb2a35b28eULL,  -688 },
+      { 0x84c8d4dfd2c63f3bULL,  -661 }, { 0xc5dd44271ad3cdbaULL,  -635 }, { 0x936b9fcebb25c996ULL,  -608 },
+      { 0xdbac6c247d62a584ULL,  -582 }, { 0xa3ab66580d5fdaf6ULL,  -555 }, { 0xf3e2f893dec3f126ULL,  -529 },
+      { 0xb5b5ada8aaff80b8ULL,  -502 }, { 0x87625f056c7c4a8bULL,  -475 }, { 0xc9bcff6034c13053ULL,  -449 },
+      { 0x964e858c91ba2655ULL,  -422 }, { 0xdff9772470297ebdULL,  -396 }, { 0xa6dfbd9fb8e5b88fULL,  -369 },
+      { 0xf8a95fcf88747d94ULL,  -343 }, { 0xb94470938fa89bcfULL,  -316 }, { 0x8a08f0f8bf0f156bULL,  -289 },
+      { 0xcdb02555653131b6ULL,  -263 }, { 0x993fe2c6d07b7facULL,  -236 }, { 0xe45c10c42a2b3b06ULL,  -210 },
+      { 0xaa242499697392d3ULL,  -183 }, { 0xfd87b5f28300ca0eULL,  -157 }, { 0xbce5086492111aebULL,  -130 },
+      { 0x8cbccc096f5088ccULL,  -103 }, { 0xd1b71758e219652cULL,   -77 }, { 0x9c40000000000000ULL,   -50 },
+      { 0xe8d4a51000000000ULL,   -24 }, { 0xad78ebc5ac620000ULL,     3 }, { 0x813f3978f8940984ULL,    30 },
+      { 0xc097ce7bc90715b3ULL,    56 }, { 0x8f7e32ce7bea5c70ULL,    83 }, { 0xd5d238a4abe98068ULL,   109 },
+      { 0x9f4f2726179a2245ULL,   136 }, { 0xed63a231d4c4fb27ULL,   162 }, { 0xb0de65388cc8ada8ULL,   189 },
+      { 0x83c7088e1aab65dbULL,   216 }, { 0xc45d1df942711d9aULL,   242 }, { 0x924d692ca61be758ULL,   269 },
+      { 0xda01ee641a708deaULL,   295 }, { 0xa26da3999aef774aULL,   322 }, { 0xf209787bb47d6b85ULL,   348 },
+      { 0xb454e4a179dd1877ULL,   375 }, { 0x865b86925b9bc5c2ULL,   402 }, { 0xc83553c5c8965d3dULL,   428 },
+      { 0x952ab45cfa97a0b3ULL,   455 }, { 0xde469fbd99a05fe3ULL,   481 }, { 0xa59bc234db398c25ULL,   508 },
+      { 0xf6c69a72a3989f5cULL,   534 }, { 0xb7dcbf5354e9beceULL,   561 }, { 0x88fcf317f22241e2ULL,   588 },
+      { 0xcc20ce9bd35c78a5ULL,   614 }, { 0x98165af37b2153dfULL,   641 }, { 0xe2a0b5dc971f303aULL,   667 },
+      { 0xa8d9d1535ce3b396ULL,   694 }, { 0xfb9b7cd9a4a7443cULL,   720 }, { 0xbb764c4ca7a44410ULL,   747 },
+      { 0x8bab8eefb6409c1aULL,   774 }, { 0xd01fef10a657842cULL,   800 }, { 0x9b10a4e5e9913129ULL,   827 },
+      { 0xe7109bfba19c0c9dULL,   853 }, { 0xac2820d9623bf429ULL,   880 }, { 0x80444b5e7aa7cf85ULL,   907 },
+      { 0xbf21e44003acdd2dULL,   933 }, { 0x8e679c2f5e44ff8fULL,   960 }, { 0xd433179d9c8cb841ULL,   986 },
+      { 0x9e19db92b4e31ba9ULL,  1013 }, { 0xeb96bf6ebadf77d9ULL,  1039 }, { 0xaf87023b9bf0ee6bULL,  1066 }
+      };
+
+      double dK = (-61 - nE) * 0.30102999566398114 + 347; // ceil((-61 - e) * log10(2)) + 347
+      int k = static_cast<int>(dK);
+      if (dK - k > 0.0)
+         ++k;
+
+      unsigned int nIndex = static_cast<unsigned int>((k >> 3) + 1);
+      nK = -(-348 + static_cast<int>(nIndex << 3));
+      return DiyFp(powers[nIndex].f, powers[nIndex].e);
+   }
+
+   static const unsigned long long FRACTION_MASK = 0x000FFFFFFFFFFFFFULL;
+   static const unsigned long long HIDDEN_BIT = 0x0010000000000000ULL;
+
+   unsigned long long f;
+   int e;
+};
+
+inline size_t Writer::FormatNumber(double dValue, char* pBuffer)
+{
+   char* p = pBuffer;
+
+   if (dValue != dValue || dValue - dValue != 0.0) {
+      // nan & inf aren't JSON anyway; write them as we always have
+      int nLength = std::snprintf(pBuffer, NUMBER_SIZE, "%.20g", dValue);
+      return static_cast<size_t>(nLength);
+   }
+
+   if (std::signbit(dValue)) {
+      *p++ = '-';
+      dValue = -dValue;
+   }
+
+   char szDigits[24];
+   int nLength, nK;
+
+   // fast path: whole numbers that a double holds exactly are just their digits
+   if (dValue < 9007199254740992.0 && dValue == static_cast<double>(static_cast<unsigned long long>(dValue)))
+   {
+      unsigned long long nValue = static_cast<unsigned long long>(dValue);
+      char* pDigit = szDigits + sizeof(szDigits);
+      do {
+         *--pDigit = static_cast<char>('0' + nValue % 10);
+         nValue /= 10;
+      } while (nValue != 0);
+
+      size_t nDigits = szDigits + sizeof(szDigits) - pDigit;
+      std::memcpy(p, pDigit, nDigits);
+      return (p - pBuffer) + nDigits;
+   }
+
+   Grisu2(dValue, szDigits, nLength, nK);
+
+   // lay out digits * 10^nK the way JavaScript does: plain decimals for 1e-6 <= |value| < 1e21,
+   //  and an exponent beyond that
+   int nPoint = nLength + nK; // the decimal point goes after this many digits
+   if (nLength <= nPoint && nPoint <= 21)
+   {
+      // 1234e7 -> 12340000000
+      std::memcpy(p, szDigits, nLength);
+      std::memset(p + nLength, '0', nPoint - nLength);
+      p += nPoint;
+   }
+   else if (0 < nPoint && nPoint <= 21)
+   {
+      // 1234e-2 -> 12.34
+      std::memcpy(p, szDigits, nPoint);
+      p[nPoint] = '.';
+      std::memcpy(p + nPoint + 1, szDigits + nPoint, nLength - nPoint);
+      p += nLength + 1;
+   }
+   else if (-6 < nPoint && nPoint <= 0)
+   {
+      // 1234e-6 -> 0.001234
+      *p++ = '0';
+      *p++ = '.';
+      std::memset(p, '0', -nPoint);
+      std::memcpy(p - nPoint, szDigits, nLength);
+      p += nLength - nPoint;
+   }
+   else
+   {
+      // 1234e30 -> 1.234e+33
+      *p++ = szDigits[0];
+      if (nLength > 1) {
+         *p++ = '.';
+         std::memcpy(p, szDigits + 1, nLength - 1);
+         p += nLength - 1;
+      }
+
+      int nExponent = nPoint - 1;
+      *p++ = 'e';
+      *p++ = (nExponent < 0 ? '-' : '+');
+      if (nExponent < 0)
+         nExponent = -nExponent;
+      if (nExponent >= 100)
+         *p++ = static_cast<char>('0' + nExponent / 100);
+      if (nExponent >= 10)
+         *p++ = static_cast<char>('0' + nExponent / 10 % 10);
+      *p++ = static_cast<char>('0' + nExponent % 10);
+   }
+
+   return p - pBuffer;
+}
+
+inline void Writer::Grisu2(double dValue, char* pDigits, int& nLength, int& nK)
+{
+   // Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers".
+   //  the digits always read back as dValue, & are the shortest possible for all but a 
+   //  tiny fraction of inputs (where they're one digit longer)
+   const DiyFp v(dValue);
+   DiyFp minus, plus;
+   v.NormalizedBoundaries(minus, plus);
+
+   const DiyFp c = DiyFp::CachedPower(plus.e, nK);
+   const DiyFp w = v.Normalize() * c;
+   DiyFp wPlus = plus * c,
+         wMinus = minus * c;
+
+   // allow for the rounding of the multiplications
+   ++wMinus.f;
+   --wPlus.f;
+   DigitGen(w, wPlus, wPlus.f - wMinus.f, pDigits, nLength, nK);
 }
 
+inline void Writer::DigitGen(const DiyFp& w, const DiyFp& mp, unsigned long long nDelta, char* pDigits, int& nLength, int& nK)
+{
+   static const unsigned long long nPowersOf10[] = {
+      1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 
+      100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 
+      10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 
+      100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+   };
+
+   // mp split at the binary point: integral part p1 (which fits 32 bits), fraction p2
+   const DiyFp one(1ULL << -mp.e, mp.e);
+   const DiyFp distance = mp - w;
+   unsigned int p1 = static_cast<unsigned int>(mp.f >> -one.e);
+   unsigned long long p2 = mp.f & (one.f - 1);
+
+   int nKappa = 1;
+   while (nKappa < 10 && p1 >= nPowersOf10[nKappa])
+      ++nKappa;
+
+   nLength = 0;
+   while (nKappa > 0)
+   {
+      unsigned int nDivisor = static_cast<unsigned int>(nPowersOf10[nKappa - 1]);
+      unsigned int d = p1 / nDivisor;
+      p1 %= nDivisor;
+      if (d != 0 || nLength != 0)
+         pDigits[nLength++] = static_cast<char>('0' + d);
+      --nKappa;
+
+      unsigned long long nRest = (static_cast<unsigned long long>(p1) << -one.e) + p2;
+      if (nRest <= nDelta) {
+         nK += nKappa;
+         GrisuRound(pDigits, nLength, nDelta, nRest, nPowersOf10[nKappa] << -one.e, distance.f);
+         return;
+      }
+   }
+
+   for (;;)
+   {
+      p2 *= 10;
+      nDelta *= 10;
+      unsigned int d = static_cast<unsigned int>(p2 >> -one.e);
+      if (d != 0 || nLength != 0)
+         pDigits[nLength++] = static_cast<char>('0' + d);
+      p2 &= one.f - 1;
+      --nKappa;
+
+      if (p2 < nDelta) {
+         nK += nKappa;
+         GrisuRound(pDigits, nLength, nDelta, p2, one.f, distance.f * (-nKappa < 20 ? nPowersOf10[-nKappa] : 0));
+         return;
+      }
+   }
+}
+
+inline void Writer::GrisuRound(char* pDigits, int nLength, unsigned long long nDelta, unsigned long long nRest, 
+                               unsigned long long nTenKappa, unsigned long long nDistance)
+{
+   // nudge the last digit down while that stays in range & gets closer to the real value
+   while (nRest < nDistance && nDelta - nRest >= nTenKappa &&
+          (nRest + nTenKappa < nDistance || nDistance - nRest > nRest + nTenKappa - nDistance))
+   {
+      --pDigits[nLength - 1];
+      nRest += nTenKappa;
+   }
+}
+
+
 inline void Writer::Visit(const Array& array)       { Write_i(array); }
 inline void Writer::Visit(const Object& object)     { Write_i(object); }
 inline void Writer::Visit(const Number& number)     { Write_i(number); }
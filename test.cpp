@@ -28,10 +28,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ******************************************************************************/
 
 #include "json/reader.h"
+#include "json/lazy.h"
+#include "json/parallelreader.h"
+#include "json/pushreader.h"
+#include "json/streamwriter.h"
 #include "json/writer.h"
 #include "json/elements.h"
 
+#include <algorithm>
 #include <sstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// prints what a check verified, & whether it held
+void Check(const char* szWhat, bool bHeld)
+{
+   std::cout << szWhat << ": " << (bHeld ? "true" : "false") << std::endl << std::endl;
+}
 
 
 int main()
@@ -83,6 +98,16 @@ int main()
    objDocument["Delicious Beers"][1]["ABV"] = Number(3.8);
    objDocument["Delicious Beers"][1]["BottleConditioned"] = Boolean(false);
 
+   // whole subtrees can also be moved into place instead of copied, which leaves 
+   //  the source empty
+   Array arrayBeerMoved(arrayBeer);
+   Object objMovedInto;
+   objMovedInto["Delicious Beers"] = std::move(arrayBeerMoved);
+   const Object& objMovedIntoConst = objMovedInto;
+   bool bMovedInto = (arrayBeerMoved.Empty() && 
+                      static_cast<const Array&>(objMovedIntoConst["Delicious Beers"]) == arrayBeer);
+   Check("Array moved into an object arrives whole, and leaves the source empty", bMovedInto);
+
    
    ////////////////////////////////////////////////////////////////////
    // interpretation
@@ -160,6 +185,11 @@ int main()
       std::cout << "Caught json::Exception: " << e.what() << std::endl << std::endl;
    }
 
+   // ...which we can avoid by asking first. Type() & the Is*() predicates never throw
+   const UnknownElement& elemBeers = objRoot["Delicious Beers"];
+   bool bIsArray = (elemBeers.IsObject() == false && elemBeers.Type() == UnknownElement::ARRAY_ELEMENT);
+   Check("\"Delicious Beers\" is an Array, not an Object, going by Type() & IsObject()", bIsArray);
+
 
    ////////////////////////////////////////////////////////////////////
    // document deep copying
@@ -202,6 +232,404 @@ int main()
    std::cout << "Original document and streamed document should be equivalent. operator == returned: "
       << (bEquals ? "true" : "false") << std::endl << std::endl;
 
+   // reading the whole stream leaves it at the end, but not failed
+   std::istringstream streamSmall("{\"a\" : 1}");
+   UnknownElement elemSmall;
+   bool bStreamGood = ((streamSmall >> elemSmall) && streamSmall.eof());
+   Check("Stream left at its end, not failed, after a read", bStreamGood);
+
+   // documents already in memory can be read straight out of the buffer, skipping the stream
+   Object elemRootBuffer;
+   Reader::Read(elemRootBuffer, stream.str());
+
+   bool bBufferEquals = (objRoot == elemRootBuffer);
+   Check("Document read from a buffer equals the original", bBufferEquals);
+
+   // output doesn't have to be pretty: compact mode leaves out all the white space
+   std::stringstream streamCompact;
+   Writer::Options optionsCompact;
+   optionsCompact.m_bCompact = true;
+   Writer::Write(objRoot, streamCompact, optionsCompact);
+
+   Object elemRootCompact;
+   Reader::Read(elemRootCompact, streamCompact.str());
+
+   bool bCompactEquals = (objRoot == elemRootCompact && streamCompact.str().size() < stream.str().size());
+   Check("Document written compactly reads back equal to the original", bCompactEquals);
+
+   // or straight into a std::string, skipping the stream altogether. the string is 
+   //  appended to, so one buffer can be cleared & reused for many documents
+   std::string sDirect;
+   Writer::Write(objRoot, sDirect);
+
+   Object elemRootDirect;
+   Reader::Read(elemRootDirect, sDirect);
+
+   bool bDirectEquals = (objRoot == elemRootDirect && sDirect == stream.str());
+   Check("Document written to a std::string reads back equal to the original", bDirectEquals);
+
+   // numbers are written with as few digits as it takes to read them back exactly
+   Array arrayFractions;
+   arrayFractions.Insert(Number(0.1));
+   arrayFractions.Insert(Number(1.0 / 3));
+   arrayFractions.Insert(Number(-2.5e-300));
+
+   std::string sFractions;
+   Writer::Write(arrayFractions, sFractions, optionsCompact);
+
+   Array arrayFractionsRead;
+   Reader::Read(arrayFractionsRead, sFractions);
+
+   bool bFractionsEquals = (arrayFractions == arrayFractionsRead && sFractions == "[0.1,0.3333333333333333,-2.5e-300]");
+   Check("Numbers written in the fewest digits that read back the same", bFractionsEquals);
+
+   // control characters without a short escape of their own are written as \u00XX
+   String stringControl("bell\a, tab\t, quote\"");
+   std::string sControl;
+   Writer::Write(stringControl, sControl);
+
+   String stringControlRead;
+   Reader::Read(stringControlRead, sControl);
+
+   bool bControlEquals = (stringControl == stringControlRead && sControl == "\"bell\\u0007, tab\\t, quote\\\"\"");
+   Check("Control characters escaped as \\u00XX, and read back unchanged", bControlEquals);
+
+   // a high surrogate pairs with a following \uDC00-\uDFFF, and is lone before anything else
+   String stringPair, stringLone;
+   Reader::Read(stringPair, std::string("\"\\uD83D\\uDE00\""));
+   Reader::Read(stringLone, std::string("\"\\uD800\\n\""));
+
+   bool bSurrogatesEqual = (stringPair.Value() == "\xF0\x9F\x98\x80" && stringLone.Value() == "\xED\xA0\x80\n");
+   Check("Surrogate pair read as one code point, lone high surrogate before \\n kept", bSurrogatesEqual);
+
+   // a Document allocates everything it reads from one arena, which makes reading 
+   //  quicker & throwing the whole thing away almost free
+   Document document;
+   Reader::Read(document, stream.str());
+   const Object& objArena = document.Root();
+
+   bool bDocumentEquals = (objRoot == objArena);
+   Check("Document read into an arena equals the original", bDocumentEquals);
+
+   // the arena itself hands out memory at any alignment, however oddly sized the
+   //  allocations before it (a big one gets a block of its own, ending unaligned)
+   Arena arena;
+   std::fill_n(static_cast<char*>(arena.Allocate(1000001, 1)), 1000001, 'x');
+   bool bAligned = true;
+   for (size_t nAlignment = 16; nAlignment >= 1; nAlignment /= 2)
+   {
+      char* pAllocated = static_cast<char*>(arena.Allocate(nAlignment + 3, nAlignment));
+      std::fill_n(pAllocated, nAlignment + 3, 'x');
+      bAligned = bAligned && (reinterpret_cast<size_t>(pAllocated) % nAlignment == 0);
+   }
+   Check("Arena allocations aligned as asked, after oddly sized ones", bAligned);
+
+   // elements moved out of a document are copied onto the heap, so they outlive it
+   UnknownElement elemMovedOut;
+   Array arrayMovedOut;
+   {
+      Document documentTemp;
+      Reader::Read(documentTemp, stream.str());
+      elemMovedOut = std::move(documentTemp.Root()["Delicious Beers"]);
+      arrayMovedOut.Insert(std::move(documentTemp.Root()["AnotherMember"]));
+   }
+   const Array& arrayBeerMovedOut = elemMovedOut;
+   bool bMovedOutEquals = (arrayBeerMovedOut == static_cast<const Array&>(objRoot["Delicious Beers"]) &&
+                           arrayMovedOut[0] == objRoot["AnotherMember"]);
+   Check("Elements moved out of a document still intact after it's gone", bMovedOutEquals);
+
+   // so is a whole array move-constructed out of one. growing an array in the arena
+   //  moves its elements along rather than copying them
+   Document documentBeers;
+   Reader::Read(documentBeers, stream.str());
+   Array arrayConstructedOut(std::move(static_cast<Array&>(documentBeers["Delicious Beers"])));
+   documentBeers.Clear();
+   Reader::Read(documentBeers, "[{\"Name\": \"Grolsch\"}]");
+   Array& arrayGrowing = documentBeers.Root();
+   const Object* pGrowingFirst = &static_cast<const Object&>(static_cast<const Array&>(arrayGrowing)[0]);
+   for (int nElement = 0; nElement < 100; ++nElement)
+      arrayGrowing.Insert(Number(nElement));
+   bool bConstructedOutEquals = (arrayConstructedOut.GetArena() == 0 &&
+                                 arrayConstructedOut == static_cast<const Array&>(objRoot["Delicious Beers"]) &&
+                                 &static_cast<const Object&>(static_cast<const Array&>(arrayGrowing)[0]) == pGrowingFirst);
+   Check("Array move-constructed out of a document on the heap & intact after Clear, arena array grown without copying its elements", bConstructedOutEquals);
+
+   // arrays of nothing but numbers are read into a packed double[], which Numbers() 
+   //  exposes directly. element access still works; non-const access unpacks the array
+   Array arrayNumbers;
+   Reader::Read(arrayNumbers, "[0.5, 1.5, 2, 3]");
+
+   double dSum = 0;
+   const double* pNumbers = arrayNumbers.Numbers();
+   for (size_t nIndex = 0; pNumbers && nIndex < arrayNumbers.Size(); ++nIndex)
+      dSum += pNumbers[nIndex];
+
+   const Array& arrayConst = arrayNumbers;
+   const Number& numberLast = arrayConst[3];
+   bool bPackedEquals = (arrayNumbers.IsPacked() && dSum == 7 && numberLast.Value() == 3);
+   Check("Packed array read, summed through Numbers() and read through a const element", bPackedEquals);
+
+   // Numbers() is only ever 0 for an array that isn't packed, empty or not
+   Array arrayEmpty;
+   const Array& arrayEmptyConst = arrayEmpty;
+   bool bEmptyPacked = (arrayEmptyConst.Numbers() == 0 && arrayEmpty.Pack() && arrayEmptyConst.Numbers() != 0 && 
+                        arrayEmpty.Numbers() != 0 && arrayEmpty.Size() == 0);
+   Check("Empty array's Numbers() null until it's packed, then non-null", bEmptyPacked);
+
+   // copies share their subtrees with the original until written to, so handing out
+   //  copies is cheap. writing to one leaves the original (& other copies) alone
+   UnknownElement elemShared(elemRootBuffer);
+   UnknownElement elemCopy(elemShared);
+   elemCopy["Delicious Beers"][0]["Name"] = String("Budweiser");
+
+   const UnknownElement& elemOriginal = elemShared;
+   bool bSharedEquals = (elemShared == UnknownElement(objRoot) && 
+                         String(elemOriginal["Delicious Beers"][0]["Name"]) == String("Schlafly American Pale Ale") &&
+                         (elemCopy == elemShared) == false);
+   Check("Writes to a copy leave the shared original alone", bSharedEquals);
+
+   // a reference taken before a copy still shows the contents from before a write 
+   //  through the element, even once the copy is gone
+   UnknownElement elemPinned;
+   Reader::Read(elemPinned, "{ \"Name\" : \"Schlafly American Pale Ale\" }");
+   const String& stringName = static_cast<const UnknownElement&>(elemPinned)["Name"];
+   {
+      UnknownElement elemTemp(elemPinned);
+      static_cast<String&>(elemPinned["Name"]).Value() = "Budweiser";
+   }
+   bool bReferenceEquals = (stringName.Value() == "Schlafly American Pale Ale" &&
+                            String(static_cast<const UnknownElement&>(elemPinned)["Name"]) == String("Budweiser"));
+   Check("Reference taken before a copy & a write still shows the old value", bReferenceEquals);
+
+   // writing to an element only keeps the next copy from sharing the levels written 
+   //  to; everything else is shared, & later copies share the lot again
+   UnknownElement elemConfig(objRoot);
+   elemConfig["Delicious Beers"][0]["Name"] = String("Budweiser");
+   UnknownElement elemRequest1(elemConfig), elemRequest2(elemConfig);
+
+   const UnknownElement& elemConfigConst = elemConfig;
+   const UnknownElement& elemRequest1Const = elemRequest1;
+   const UnknownElement& elemRequest2Const = elemRequest2;
+   bool bWrittenShared = (&static_cast<const Object&>(elemRequest1Const["Delicious Beers"][1]) ==
+                             &static_cast<const Object&>(elemConfigConst["Delicious Beers"][1]) &&
+                          &static_cast<const Object&>(elemRequest2Const) == &static_cast<const Object&>(elemConfigConst) &&
+                          elemRequest1 == elemConfig);
+   Check("Copies made after a write share the subtrees it didn't touch", bWrittenShared);
+
+   // reading (or writing out) one copy of a shared tree doesn't stop later copies of
+   //  it from sharing too
+   UnknownElement elemCache(objRoot);
+   UnknownElement elemHandler1(elemCache), elemHandler2(elemCache);
+   const Object& objHandler1 = static_cast<const UnknownElement&>(elemHandler1);
+   std::string sHandler1;
+   Writer::Write(objHandler1, sHandler1);
+
+   UnknownElement elemHandler3(elemCache);
+   const Object& objHandler3 = static_cast<const UnknownElement&>(elemHandler3);
+   bool bStillShared = (&objHandler3 == &objHandler1 && sHandler1 == stream.str());
+   Check("Copies made after a const read & a write out of one copy still share", bStillShared);
+
+   // given a NameTable, member names are interned as they're read, so documents 
+   //  sharing one share one copy of each name (& look them up by pointer)
+   NameTable names;
+   Document documentA(names), documentB(names);
+   Reader::Read(documentA, stream.str());
+   Reader::Read(documentB, stream.str());
+
+   const Object& objA = documentA.Root();
+   const Object& objB = documentB.Root();
+   bool bNamesEquals = (objA == objB && 
+                        &objA.Begin()->name.Value() == &objB.Begin()->name.Value() &&
+                        objA.Find(names.Intern("Delicious Beers")) != objA.End() &&
+                        static_cast<const Object&>(document.Root()).Begin()->name.IsInterned() == false);
+   Check("Documents sharing a name table share member names; a document without one doesn't intern", bNamesEquals);
+
+   // members can be renamed & reordered in place, even in an object big enough to 
+   //  keep an index of its names
+   Object objRenamed;
+   for (char c = 'a'; c <= 'z'; ++c)
+      objRenamed[std::string(1, c)] = Number(c);
+
+   objRenamed.Find("m")->name = "zz";
+   objRenamed.Begin()->name += "a";
+   std::reverse(objRenamed.Begin(), objRenamed.End());
+   const Object& objRenamedConst = objRenamed;
+   bool bRenamedEquals = (objRenamedConst.Find("m") == objRenamedConst.End() &&
+                          Number(objRenamedConst["zz"]) == Number('m') &&
+                          Number(objRenamedConst["aa"]) == Number('a') &&
+                          objRenamed.Find("z") == objRenamed.Begin() &&
+                          objRenamed.Size() == 26);
+   Check("Renamed & reordered members found under their new names only", bRenamedEquals);
+
+   ////////////////////////////////////////////////////////////////////
+   // incremental reading
+
+   // documents arriving a piece at a time (i.e. over a network) can be read as they 
+   //  come in. here we pretend the document shows up seven characters at a time
+   PushReader pushReader;
+   const std::string sDocument = stream.str();
+   for (size_t nOffset = 0; pushReader.IsComplete() == false; nOffset += 7)
+      pushReader.Feed(sDocument.data() + nOffset, std::min<size_t>(7, sDocument.size() - nOffset));
+
+   bool bPushEquals = (objRoot == pushReader.Root());
+   Check("Document fed to PushReader 7 bytes at a time equals the original", bPushEquals);
+
+   // a name used twice in one object is a parse error, just as it is for Reader
+   try
+   {
+      std::cout << "Pushing a duplicate member name; expecting Parse exception" << std::endl;
+      PushReader pushReaderDuplicate;
+      pushReaderDuplicate.Feed("{\"a\" : 1, \"a\" : 2}", 18);
+   }
+   catch (Reader::ParseException& e)
+   {
+      std::cout << "Caught json::ParseException: " << e.what() << ", Line/offset: " << e.m_locTokenBegin.m_nLine + 1
+                << '/' << e.m_locTokenBegin.m_nLineOffset + 1 << std::endl << std::endl;
+   }
+
+
+   ////////////////////////////////////////////////////////////////////
+   // multiple documents
+
+   // newline-delimited or concatenated documents can be read one record at a time
+   std::istringstream sRecords("{\"Name\" : \"Pliny the Elder\"}\n{\"Name\" : \"Hopslam\"}\n[1, 2] 3");
+   RecordReader recordReader(sRecords);
+   UnknownElement elemRecord;
+   int nRecords = 0;
+   while (recordReader.Read(elemRecord))
+      ++nRecords;
+   std::cout << "Records read from stream (should be 4): " << nRecords << std::endl << std::endl;
+
+
+   ////////////////////////////////////////////////////////////////////
+   // event-driven reading
+
+   // a document can also be read without building any elements at all. a Handler
+   //  gets each piece as soon as it's read; this one just totals up the ABVs
+   class AbvTotaler : public Handler
+   {
+   public:
+      AbvTotaler() : m_dTotal(0), m_bAbv(false) {}
+
+      virtual void BeginObject() {}
+      virtual void Key(const std::string& name) { m_bAbv = (name == "ABV"); }
+      virtual void EndObject() {}
+      virtual void BeginArray() {}
+      virtual void EndArray() {}
+      virtual void Value(const Number& number) { if (m_bAbv) m_dTotal += number.Value(); }
+      virtual void Value(const String&) {}
+      virtual void Value(const Boolean&) {}
+      virtual void Value(const Null&) {}
+
+      double m_dTotal;
+      bool m_bAbv;
+   };
+
+   AbvTotaler abvTotaler;
+   Reader::Read(abvTotaler, stream.str());
+   std::cout << "Total ABV of all beers (should be 7.6): " << abvTotaler.m_dTotal << std::endl << std::endl;
+
+
+   ////////////////////////////////////////////////////////////////////
+   // streaming writing
+
+   // the other way around: a StreamWriter writes a document as it's described,
+   //  without any elements in between. mistakes (a value where a member name 
+   //  belongs, unbalanced brackets...) throw json::Exception
+   std::string sStreamed;
+   StreamWriter streamWriter(sStreamed);
+   streamWriter.BeginObject();
+   streamWriter.Key("Brewery");
+   streamWriter.Value(String("Samuel Smith"));
+   streamWriter.Key("Years");
+   streamWriter.BeginArray();
+   for (int nYear = 1758; nYear <= 1760; ++nYear)
+      streamWriter.Value(Number(nYear));
+   streamWriter.EndArray();
+   streamWriter.EndObject();
+   streamWriter.Finish();
+
+   Object objStreamed;
+   objStreamed["Brewery"] = String("Samuel Smith");
+   Array& arrayYears = objStreamed["Years"];
+   for (int nYear = 1758; nYear <= 1760; ++nYear)
+      arrayYears.Insert(Number(nYear));
+
+   std::string sTree;
+   Writer::Write(objStreamed, sTree);
+
+   // StreamWriter is also a Handler, so a document can be rewritten without being built
+   std::string sRewritten;
+   StreamWriter streamRewriter(sRewritten, optionsCompact);
+   Reader::Read(streamRewriter, sStreamed);
+   streamRewriter.Finish();
+
+   bool bStreamedEquals = (sStreamed == sTree && sRewritten == "{\"Brewery\":\"Samuel Smith\",\"Years\":[1758,1759,1760]}");
+   Check("StreamWriter output identical to Writer's", bStreamedEquals);
+
+
+   ////////////////////////////////////////////////////////////////////
+   // parallel reading
+
+   // big arrays can be split up & read on several threads at once
+   std::ostringstream streamNumbers;
+   streamNumbers << '[';
+   for (int nNumber = 0; nNumber < 50000; ++nNumber)
+      streamNumbers << (nNumber ? "," : "") << nNumber;
+   streamNumbers << ']';
+
+   Array arraySequential, arrayParallel;
+   Reader::Read(arraySequential, streamNumbers.str());
+   ParallelReader parallelReader(4);
+   parallelReader.Read(arrayParallel, streamNumbers.str());
+
+   bool bParallelEquals = (arraySequential == arrayParallel && arrayParallel.IsPacked());
+   Check("Array read by ParallelReader equals the sequentially read one, and is packed", bParallelEquals);
+
+   // given a (thread-safe) NameTable, every thread interns the names it reads in it
+   std::ostringstream streamRecords;
+   streamRecords << '[';
+   for (int nRecord = 0; nRecord < 20000; ++nRecord)
+      streamRecords << (nRecord ? "," : "") << "{\"Id\": " << nRecord << '}';
+   streamRecords << ']';
+
+   NameTable namesShared(true);
+   Array arrayRecords;
+   ParallelReader(4, namesShared).Read(arrayRecords, streamRecords.str());
+   const Object& objFirstRecord = static_cast<const Array&>(arrayRecords)[0];
+   const Object& objLastRecord = static_cast<const Array&>(arrayRecords)[19999];
+   bool bRecordNamesShared = (&objFirstRecord.Begin()->name.Value() == &objLastRecord.Begin()->name.Value() &&
+                              namesShared.Size() == 1);
+   Check("Records read in parallel share one interned copy of each member name", bRecordNamesShared);
+
+   // const access to a packed array is safe from several threads at once; the first
+   //  one in fills the element cache while the others wait for that array alone
+   const Array& arrayShared = arrayParallel;
+   std::vector<double> sums(4);
+   std::vector<std::thread> threads;
+   for (size_t nThread = 0; nThread < sums.size(); ++nThread)
+   {
+      threads.push_back(std::thread([&arrayShared, &sums, nThread]() {
+         for (size_t nIndex = 0; nIndex < arrayShared.Size(); ++nIndex)
+            sums[nThread] += static_cast<const Number&>(arrayShared[nIndex]).Value();
+      }));
+   }
+   for (size_t nThread = 0; nThread < threads.size(); ++nThread)
+      threads[nThread].join();
+
+   bool bSumsEqual = (std::count(sums.begin(), sums.end(), 49999.0 * 50000 / 2) == 4 && arrayShared.IsPacked());
+   Check("Packed array summed on four threads at once gives the same sum on each", bSumsEqual);
+
+
+   ////////////////////////////////////////////////////////////////////
+   // lazy reading
+
+   // when only a value or two out of a big document is needed, a LazyDocument indexes
+   //  the buffer & reads just what's asked for
+   LazyDocument lazyDocument(sDocument.data(), sDocument.size());
+   String strLazyOrigin = lazyDocument["Delicious Beers"][1]["Origin"];
+   std::cout << "Lazily read origin (should be Tadcaster, Yorkshire, UK): " << strLazyOrigin.Value() << std::endl << std::endl;
+
 
    ////////////////////////////////////////////////////////////////////
    // document read error handling